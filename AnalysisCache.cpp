@@ -0,0 +1,232 @@
+#include "AnalysisCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// file layout version; a new one makes every older file a miss.
+static const uint32_t CACHE_VERSION = 1;
+static const char CACHE_MAGIC[8] = {'C', 'Y', 'O', 'A', 'R', 'S', 'L', 'T'};
+
+// header of a result file, followed by count uint32 words.
+struct CacheHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t hash[2];
+    uint64_t page_num;
+    uint64_t choice_num;
+    uint64_t count;
+};
+
+/**
+ * @brief mix one word into a hash lane.
+ * 
+ * @param h the lane.
+ * @param word the word.
+ * @param multiplier the lane's odd multiplier.
+ * @return uint64_t the new lane.
+ */
+static uint64_t mixWord(uint64_t h, uint64_t word, uint64_t multiplier){
+    h = (h ^ word) * multiplier;
+    return h ^ (h >> 29);
+}
+
+/**
+ * @brief Construct a new AnalysisCache object, hashing the page number, then
+ * each page's type and choices.
+ * 
+ * @param dir cache directory, made if missing.
+ * @param graph the story's choices.
+ * @param types the page types, indexed by page number - 1.
+ */
+AnalysisCache::AnalysisCache(const std::string & dir, const StoryGraph & graph, const uint8_t * types): graph(graph), dir(dir), key(), page_num(graph.getPageNum()), choice_num(graph.getChoiceNum()) {
+    static const uint64_t MULTIPLIER[2] = {0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL};
+    for(size_t lane = 0; lane < 2; ++lane){
+        uint64_t h = mixWord(lane + 1, page_num, MULTIPLIER[lane]);
+        for(size_t pn = 1; pn <= page_num; ++pn){
+            Span<uint32_t> options = graph.getChoices(pn);
+            h = mixWord(h, ((uint64_t)types[pn - 1] << 32) | options.size(), MULTIPLIER[lane]);
+            for(size_t i = 0; i < options.size(); ++i){
+                h = mixWord(h, options[i], MULTIPLIER[lane]);
+            }
+        }
+        hash[lane] = h;
+    }
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)hash[0], (unsigned long long)hash[1]);
+    key = hex;
+    mkdir(dir.c_str(), 0777);
+}
+
+/**
+ * @brief get the story's key.
+ * 
+ * @return const std::string& 32 hex digits.
+ */
+const std::string & AnalysisCache::getKey() const{
+    return key;
+}
+
+/**
+ * @brief read a result file. A file of another layout version, of another
+ * story or cut short is a miss.
+ * 
+ * @param kind file name extension of the result.
+ * @param data the result's words.
+ * @return true the result was read.
+ * @return false there is no usable result.
+ */
+bool AnalysisCache::load(const char * kind, std::vector<uint32_t> & data) const{
+    std::ifstream f((dir + "/" + key + "." + kind).c_str(), std::ios::binary);
+    CacheHeader header;
+    if(!f.read((char *)&header, sizeof(header)) || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+       || header.version != CACHE_VERSION || header.hash[0] != hash[0] || header.hash[1] != hash[1]
+       || header.page_num != page_num || header.choice_num != choice_num){
+        return false;
+    }
+    f.seekg(0, std::ios::end);
+    uint64_t size = f? (uint64_t)f.tellg() : 0; // count * 4 could wrap, so the size is divided instead
+    if(size < sizeof(header) || (size - sizeof(header)) % sizeof(uint32_t) != 0
+       || (size - sizeof(header)) / sizeof(uint32_t) != header.count){
+        return false;
+    }
+    f.seekg(sizeof(header));
+    data.resize(header.count);
+    return (bool)f.read((char *)data.data(), header.count * sizeof(uint32_t));
+}
+
+/**
+ * @brief write a result file. It is written under a name of this process and
+ * renamed into place, so readers never see half a file. A cache that can't
+ * be written is skipped.
+ * 
+ * @param kind file name extension of the result.
+ * @param data the result's words.
+ */
+void AnalysisCache::save(const char * kind, const std::vector<uint32_t> & data) const{
+    std::string name = dir + "/" + key + "." + kind;
+    std::string temp = name + ".tmp" + std::to_string(getpid());
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.hash[0] = hash[0];
+    header.hash[1] = hash[1];
+    header.page_num = page_num;
+    header.choice_num = choice_num;
+    header.count = data.size();
+    std::ofstream f(temp.c_str(), std::ios::binary | std::ios::trunc);
+    f.write((const char *)&header, sizeof(header));
+    f.write((const char *)data.data(), data.size() * sizeof(uint32_t));
+    f.close();
+    if(!f || rename(temp.c_str(), name.c_str()) != 0){
+        unlink(temp.c_str());
+    }
+}
+
+/**
+ * @brief get the cached depths.
+ * 
+ * @param depth depth of each page, indexed by page number.
+ * @return true the depths were cached.
+ * @return false they were not.
+ */
+bool AnalysisCache::loadDepth(std::vector<uint32_t> & depth) const{
+    return load("depth", depth) && depth.size() == page_num + 1;
+}
+
+/**
+ * @brief cache the depths.
+ * 
+ * @param depth depth of each page, indexed by page number.
+ */
+void AnalysisCache::saveDepth(const std::vector<uint32_t> & depth) const{
+    save("depth", depth);
+}
+
+/**
+ * @brief check that a cached route is a route of the story: it starts on
+ * page 1, each choice number is one of its page's choices and leads to the
+ * next page, and the last page has no choices. A route of another story
+ * whose hash collides, or from a damaged file, fails.
+ * 
+ * @param route (page num, choice num) pairs; the last choice num is unused.
+ * @return true the route can be printed.
+ * @return false it can't.
+ */
+bool AnalysisCache::isRoute(const Route & route) const{
+    if(route.empty() || route[0].first != 1){
+        return false;
+    }
+    for(size_t j = 0; j < route.size(); ++j){
+        if(route[j].first == 0 || route[j].first > page_num){
+            return false;
+        }
+        Span<uint32_t> options = graph.getChoices(route[j].first);
+        if(j + 1 == route.size()){
+            return options.empty();
+        }
+        if(route[j].second == 0 || route[j].second > options.size() || options[route[j].second - 1] != route[j + 1].first){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief get the cached WIN routes. They are stored as the route number,
+ * then each route's length and its (page num, choice num) pairs. Routes that
+ * are not routes of the story make the whole file a miss, so the search is
+ * run again.
+ * 
+ * @param routes the routes, in the order they were found.
+ * @return true the routes were cached.
+ * @return false they were not.
+ */
+bool AnalysisCache::loadRoutes(std::vector<Route> & routes) const{
+    std::vector<uint32_t> data;
+    if(!load("routes", data) || data.empty() || data[0] > data.size() - 1){
+        return false;
+    }
+    routes.assign(data[0], Route());
+    size_t at = 1;
+    for(size_t i = 0; i < routes.size(); ++i){
+        if(at >= data.size() || data[at] > (data.size() - at - 1) / 2){
+            routes.clear();
+            return false;
+        }
+        routes[i].resize(data[at++]);
+        for(size_t j = 0; j < routes[i].size(); ++j, at += 2){
+            routes[i][j] = std::pair<size_t, size_t>(data[at], data[at + 1]);
+        }
+        if(!isRoute(routes[i])){
+            routes.clear();
+            return false;
+        }
+    }
+    return at == data.size();
+}
+
+/**
+ * @brief cache the WIN routes. The route number and lengths are stored as
+ * 32-bit words, so more routes than that are not cached.
+ * 
+ * @param routes the routes, in the order they were found.
+ */
+void AnalysisCache::saveRoutes(const std::vector<Route> & routes) const{
+    if(routes.size() > UINT32_MAX){
+        return;
+    }
+    std::vector<uint32_t> data(1, routes.size());
+    for(size_t i = 0; i < routes.size(); ++i){
+        data.push_back(routes[i].size());
+        for(size_t j = 0; j < routes[i].size(); ++j){
+            data.push_back(routes[i][j].first);
+            data.push_back(routes[i][j].second);
+        }
+    }
+    save("routes", data);
+}
@@ -0,0 +1,52 @@
+#ifndef ANALYSIS_CACHE_HPP
+#define ANALYSIS_CACHE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "RouteSearch.hpp"
+#include "StoryGraph.hpp"
+
+// analysis results of stories kept in a directory, one file per result,
+// named by a hash of what the results depend on: the page types and the
+// choices. Any change to them gives another name, so stale results are never
+// read; changes to texts and labels keep the results.
+class AnalysisCache{
+public:
+    // constructor: the story's graph and page types, indexed by page number - 1.
+    AnalysisCache(const std::string & dir, const StoryGraph & graph, const uint8_t * types);
+
+    // get the cached depths; false if there are none.
+    bool loadDepth(std::vector<uint32_t> & depth) const;
+
+    // cache the depths.
+    void saveDepth(const std::vector<uint32_t> & depth) const;
+
+    // get the cached WIN routes; false if there are none.
+    bool loadRoutes(std::vector<Route> & routes) const;
+
+    // cache the WIN routes.
+    void saveRoutes(const std::vector<Route> & routes) const;
+
+    // get the story's key, as the hexadecimal part of the file names.
+    const std::string & getKey() const;
+
+private:
+    // check that a cached route is a route of the story.
+    bool isRoute(const Route & route) const;
+
+    // read a result file whose header matches; false if there is none.
+    bool load(const char * kind, std::vector<uint32_t> & data) const;
+
+    // write a result file under a temporary name, then rename it.
+    void save(const char * kind, const std::vector<uint32_t> & data) const;
+
+    const StoryGraph & graph;
+    std::string dir; // cache directory
+    uint64_t hash[2]; // hash of the page types and choices
+    std::string key; // the hash as 32 hex digits
+    uint64_t page_num;
+    uint64_t choice_num;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "BigCount.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Construct a new BigCount object
+ * 
+ * @param value initial value.
+ */
+BigCount::BigCount(uint64_t value): limbs() {
+    while(value != 0){
+        limbs.push_back((uint32_t)value);
+        value >>= 32;
+    }
+}
+
+/**
+ * @brief add another count.
+ * 
+ * @param other the count to add.
+ * @return BigCount& this count.
+ */
+BigCount & BigCount::operator+=(const BigCount & other){
+    if(limbs.size() < other.limbs.size()){
+        limbs.resize(other.limbs.size(), 0);
+    }
+    uint64_t carry = 0;
+    for(size_t i = 0; i < limbs.size() && (i < other.limbs.size() || carry != 0); ++i){
+        carry += (uint64_t)limbs[i] + (i < other.limbs.size()? other.limbs[i] : 0);
+        limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if(carry != 0){
+        limbs.push_back((uint32_t)carry);
+    }
+    return *this;
+}
+
+/**
+ * @brief multiply two counts.
+ * 
+ * @param other the other factor.
+ * @return BigCount the product.
+ */
+BigCount BigCount::operator*(const BigCount & other) const{
+    BigCount product;
+    if(isZero() || other.isZero()){
+        return product;
+    }
+    product.limbs.assign(limbs.size() + other.limbs.size(), 0);
+    for(size_t i = 0; i < limbs.size(); ++i){
+        uint64_t carry = 0;
+        for(size_t j = 0; j < other.limbs.size(); ++j){
+            carry += (uint64_t)limbs[i] * other.limbs[j] + product.limbs[i + j];
+            product.limbs[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        product.limbs[i + other.limbs.size()] = (uint32_t)carry;
+    }
+    while(!product.limbs.empty() && product.limbs.back() == 0){
+        product.limbs.pop_back();
+    }
+    return product;
+}
+
+/**
+ * @brief check whether the count is 0.
+ * 
+ * @return true it is 0.
+ * @return false it is positive.
+ */
+bool BigCount::isZero() const{
+    return limbs.empty();
+}
+
+/**
+ * @brief get the decimal representation, nine digits per division pass.
+ * 
+ * @return std::string the decimal digits.
+ */
+std::string BigCount::toString() const{
+    if(isZero()){
+        return "0";
+    }
+    std::vector<uint32_t> rest(limbs);
+    std::string digits;
+    while(!rest.empty()){
+        uint64_t remainder = 0;
+        for(size_t i = rest.size(); i-- > 0; ){
+            uint64_t current = (remainder << 32) | rest[i];
+            rest[i] = (uint32_t)(current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        while(!rest.empty() && rest.back() == 0){
+            rest.pop_back();
+        }
+        for(int k = 0; k < 9 && (remainder != 0 || !rest.empty()); ++k){
+            digits.push_back('0' + remainder % 10);
+            remainder /= 10;
+        }
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
@@ -0,0 +1,30 @@
+#ifndef BIG_COUNT_HPP
+#define BIG_COUNT_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// arbitrary precision unsigned number, for counts that outgrow 64 bits.
+class BigCount{
+public:
+    // constructor
+    BigCount(uint64_t value = 0);
+
+    // add another count.
+    BigCount & operator+=(const BigCount & other);
+
+    // multiply two counts.
+    BigCount operator*(const BigCount & other) const;
+
+    // check whether the count is 0.
+    bool isZero() const;
+
+    // get the decimal representation.
+    std::string toString() const;
+
+private:
+    std::vector<uint32_t> limbs; // base 2^32, least significant first, no leading zero limbs
+};
+
+#endif
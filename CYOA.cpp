@@ -1,30 +1,78 @@
 #include "CYOA.hpp"
+#include "PageLoader.hpp"
+#include "Parallel.hpp"
+#include "RouteCount.hpp"
+#include "RouteSearch.hpp"
+#include "ShortestRoutes.hpp"
+#include "StoryStructure.hpp"
+#include "Stats.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <dirent.h>
+
+// page files read together by savePages.
+static const size_t LOAD_BATCH = 1024;
+// bytes read of each page file: most navigation sections fit in LAZY_BLOCK,
+// most whole pages in FULL_BLOCK.
+static const size_t LAZY_BLOCK = 4096;
+static const size_t FULL_BLOCK = 16384;
 
 // ===================================================
 
-//                  CYOA Class
+//                  Story Class
 
 // ===================================================
 /**
- * @brief Construct a new CYOA::CYOA object
+ * @brief Construct a new Story::Story object
  * 
  */
-CYOA::CYOA(): story_name(NULL), page_num(0), pages(), current_page(NULL), current_choices(), referenced() {}
+Story::Story(): story_name(), thread_num(1), read_threads(0), lazy_text(false), page_num(0), compiled(), pages(), graph(), page_depth(NULL), can_win(NULL), cache(NULL) {}
 /**
- * @brief Construct a new CYOA::CYOA object
+ * @brief Construct a new Story::Story object
  * 
- * @param directory_name 
+ * @param directory_name story directory, or a file written by cyoa-compile.
+ * @param thread_num number of threads parsing the pages and reading them
+ * without io_uring; 0 for one per hardware thread, and the loader's default
+ * for reading.
+ * @param lazy_text read only the navigation section of each page, and a page
+ * text once the page is printed.
+ * @param check_pages check the story format here; otherwise the caller must.
  */
-CYOA::CYOA(const std::string directory_name): story_name(directory_name), page_num(0), pages(), current_page(NULL), current_choices(), referenced() {
-    savePages(directory_name);
-    checkPages();
-    setCurrent(1);
+Story::Story(const std::string directory_name, size_t thread_num, bool lazy_text, bool check_pages): story_name(directory_name), thread_num(thread_num > 0? thread_num : defaultThreads()), read_threads(thread_num), lazy_text(lazy_text), page_num(0), compiled(), pages(), graph(), page_depth(NULL), can_win(NULL), cache(NULL) {
+    if(isStoryFile(directory_name)){
+        loadCompiled(directory_name);
+    }
+    else{
+        savePages(directory_name);
+    }
+    if(check_pages){
+        checkPages();
+    }
 }
 /**
- * @brief Destroy the CYOA::CYOA object
+ * @brief Construct a new Story::Story object from a story built into the
+ * program. Its tables were checked by the compiler, so the graph and the
+ * pages use them as they are, as they use a mapped compiled story; only the
+ * reverse choice arrays are built.
  * 
+ * @param embedded the story, as written by cyoa-embed.
+ * @param thread_num number of threads for the analyses.
  */
-CYOA::~CYOA(){}
+Story::Story(const EmbeddedStory & embedded, size_t thread_num): story_name(), thread_num(thread_num), read_threads(0), lazy_text(false), page_num(embedded.page_num), compiled(), pages(), graph(), page_depth(NULL), can_win(NULL), cache(NULL) {
+    graph.attach(page_num, embedded.choice_index, embedded.targets);
+    graph.finish();
+    pages.attach(page_num, embedded.choice_num, embedded.types, embedded.labels, embedded.texts, embedded.arena, embedded.arena_size);
+}
+/**
+ * @brief Destroy the Story::Story object
+ * 
+ */
+Story::~Story(){
+    delete page_depth.load();
+    delete can_win.load();
+    delete cache;
+}
 
 /**
  * @brief get each page file name.
@@ -33,87 +81,263 @@ CYOA::~CYOA(){}
  * @param num page number
  * @return std::string the path of file.
  */
-std::string CYOA::getFileName(const std::string dir, int num){
+std::string Story::getFileName(const std::string dir, size_t num){
     std::string name = dir + "/page" + std::to_string(num) + ".txt";
     return name;
 }
 
 /**
- * @brief check whether the named file exist.
+ * @brief get the page number a file name stands for, when it is spelled
+ * exactly like getFileName's: "page", at most 18 digits without leading
+ * zeros, ".txt".
+ * 
+ * @param name file name, without the directory.
+ * @return size_t the page number, or 0 if it is no page file name.
+ */
+size_t Story::pageFileNumber(const char * name){
+    size_t len = strlen(name);
+    if(len < 9 || len > 8 + 18 || strncmp(name, "page", 4) != 0 || strcmp(name + len - 4, ".txt") != 0
+       || name[4] == '0'){
+        return 0;
+    }
+    size_t pn = 0, i = 4;
+    for(; i < len - 4 && isdigit(name[i]); ++i){
+        pn = pn * 10 + (name[i] - '0');
+    }
+    return i == len - 4? pn : 0;
+}
+
+/**
+ * @brief list the story's page files with a single pass over the directory.
+ * The story is page1.txt, page2.txt, ... up to the first missing number, so
+ * only names spelled exactly like getFileName's count.
  * 
- * @param filename the file name to be checked.
- * @return true the file exist.
- * @return false the file doesn't exist.
+ * @param dir directory name
+ * @return std::vector<std::string> the path of page i + 1 at index i.
  */
-bool CYOA::hasFile(const std::string & filename){
-    std::ifstream f(filename.c_str());
-    return f.good();
+std::vector<std::string> Story::scanPages(const std::string & dir){
+    std::vector<std::pair<size_t, std::string> > found; // (page num, file name)
+    DIR * d = opendir(dir.c_str());
+    if(d != NULL){
+        struct dirent * entry;
+        while((entry = readdir(d)) != NULL){
+            size_t pn = pageFileNumber(entry->d_name);
+            if(pn != 0){
+                found.push_back(std::pair<size_t, std::string>(pn, entry->d_name));
+            }
+        }
+        closedir(d);
+    }
+
+    // the story can't be longer than the number of candidates.
+    std::vector<std::string> files(found.size());
+    for(size_t i = 0; i < found.size(); ++i){
+        if(found[i].first <= files.size()){
+            files[found[i].first - 1] = dir + "/" + found[i].second;
+        }
+    }
+    size_t count = 0;
+    while(count < files.size() && !files[count].empty()){
+        ++count;
+    }
+    files.resize(count);
+    return files;
 }
 
 /**
- * @brief add the referenced relationship.
+ * @brief add the referenced relationship: the next page's choices become its
+ * edges in the story graph.
  * 
- * @param page the new relationship in new page
+ * @param page the page whose choices are new relationships
  */
-void CYOA::addReferenced(Page & page){
-    std::vector<size_t> choice = page.getChoices();
+void Story::addReferenced(Page & page){
+    const std::vector<size_t> & choice = page.getChoices();
     for(size_t i = 0; i < choice.size(); i++){
-        size_t pn = choice[i];
-        if(pn > page_num){
+        size_t target = choice[i];
+        if(target > page_num){
             findError("There is a page number out of bound!");
         }
-        referenced[pn - 1].push_back(page.getPageNum()); // when page A has reference to pageB, referenced[B].push_back(A).
+        graph.addChoice(target);
     }
+    graph.endPage();
 }
 
 /**
- * @brief handler to store all valid pages in story.
+ * @brief handler to store all valid pages in story. The page files are found
+ * by one directory scan, then each is opened once and parsed by up to
+ * thread_num threads. Errors are reported exactly as a page-by-page load
+ * would: the first error of the lowest-numbered broken page wins, so pages
+ * after it need not be parsed. The parsed pages are then moved into the
+ * story graph and the pages' arena.
  * 
  * @param dir directory name
  */
-void CYOA::savePages(const std::string & dir){
-    std::string path = dir;
-    if(!hasFile(getFileName(dir, 1))){
+void Story::savePages(const std::string & dir){
+    STATS_PHASE(STATS_LOAD);
+    std::vector<std::string> files = scanPages(dir);
+    if(files.empty()){
         findError("page 1.txt dose not exist!");
     }
-    pages.push_back(Page(getFileName(dir, 1).c_str()));
-    ++page_num;
+    page_num = files.size();
+    if(page_num > UINT32_MAX){
+        findError("The story has too many pages!");
+    }
+
+    // the files of a batch are read together, then parsed from the loader's
+    // buffers; a page longer than a block is read again on its own.
+    std::vector<Page> parsed(page_num);
+    std::vector<std::string> errors(page_num);
+    std::atomic<size_t> first_error(page_num); // lowest broken page index so far
+    PageLoader loader(lazy_text? LAZY_BLOCK : FULL_BLOCK, std::min(page_num, LOAD_BATCH), PageLoader::getDefaultIo(), read_threads);
+    for(size_t start = 0; start < page_num && start <= first_error.load(); start += LOAD_BATCH){
+        size_t n = std::min(page_num - start, LOAD_BATCH);
+        loader.read(&files[start], n);
+        parallelFor(n, thread_num, [&](size_t k){
+            size_t i = start + k;
+            if(i > first_error.load()){
+                return;
+            }
+            try{
+                if(loader.getSize(k) < 0
+                   || !parsed[i].readPage(files[i].c_str(), loader.getData(k), loader.getSize(k), loader.isWhole(k), !lazy_text)){
+                    parsed[i].readPage(files[i].c_str(), !lazy_text);
+                }
+            }
+            catch(StoryError & e){
+                errors[i] = e.what();
+                size_t seen = first_error.load();
+                while(i < seen && !first_error.compare_exchange_weak(seen, i)){}
+            }
+        });
+    }
+    if(first_error.load() < page_num){
+        findError(errors[first_error.load()]);
+    }
 
-    while(hasFile(getFileName(dir, page_num + 1))){
-        pages.push_back(Page(getFileName(dir, ++page_num).c_str()));
+    for(size_t i = 0; i < parsed.size(); ++i){
+        addReferenced(parsed[i]);
     }
-    referenced.resize(page_num);
-    for(size_t i = 0; i < pages.size(); ++i){
-        addReferenced(pages[i]);
+    graph.finish();
+    if(lazy_text){
+        pages.build(parsed, dir);
     }
+    else{
+        pages.build(parsed);
+    }
+    STATS_ADD(STATS_PAGES_LOADED, page_num);
 }
 
 /**
- * @brief check whether the user's input is valid.
+ * @brief map a compiled story instead of reading the pages. The page format
+ * was validated by cyoa-compile, so the graph and the pages use the mapped
+ * arrays and only the reverse choice arrays are built.
  * 
- * @param choice choice description
- * @return int if valid, return positive number.
+ * @param file_name the compiled story file.
  */
-int CYOA::isValidChoice(const std::string choice){
-    size_t choice_num = current_page->isPositiveNum(choice); // number > 0 ?
-    if(choice_num > 0 && choice_num <= current_choices.size()){ // The number is greater than 0 and it's in the options
-        size_t next_page = current_choices[choice_num - 1];
-        return next_page <= page_num? next_page : 0; //If the option is within the page range, return next page number.
+void Story::loadCompiled(const std::string & file_name){
+    STATS_PHASE(STATS_LOAD);
+    compiled.open(file_name);
+    page_num = compiled.getPageNum();
+    graph.attach(page_num, compiled.getChoiceIndex(), compiled.getTargets());
+    graph.finish();
+    compiled.attachPages(pages);
+    STATS_ADD(STATS_PAGES_LOADED, page_num);
+}
+
+/**
+ * @brief keep the depths and WIN routes in a cache directory: results cached
+ * for the same page types and choices are read instead of computed, and
+ * computed results are cached. Must be called before any analysis, while
+ * no other thread uses the story.
+ * 
+ * @param cache_dir the cache directory, made if missing.
+ */
+void Story::useCache(const std::string & cache_dir){
+    delete cache;
+    cache = new AnalysisCache(cache_dir, graph, pages.getTypes());
+}
+
+/**
+ * @brief write the story as a compiled story file.
+ * 
+ * @param file_name the output file.
+ */
+void Story::compile(const std::string & file_name) const{
+    if(compiled.isOpen()){
+        findError("The story is compiled already!");
     }
-    return 0; //  Otherwise, it is invalid.
+    if(pages.isLazy()){
+        findError("The story was loaded without its page texts!");
+    }
+    StoryFile::write(file_name, pages, graph);
+}
+
+/**
+ * @brief write the story as a C++ header of constexpr tables, for a program
+ * that has the story built in.
+ * 
+ * @param file_name the output header.
+ * @param name the namespace of the tables.
+ */
+void Story::embed(const std::string & file_name, const std::string & name) const{
+    if(pages.isLazy()){
+        findError("The story was loaded without its page texts!");
+    }
+    writeEmbeddedStory(file_name, name, pages, graph);
+}
+
+/**
+ * @brief get the page type.
+ * 
+ * @param pn page number.
+ * @return PageType PAGE_CHOICE, PAGE_WIN, PAGE_LOSE
+ */
+PageType Story::getPageType(size_t pn) const{
+    return pages.getType(pn);
+}
+
+/**
+ * @brief get the optional page numbers of a page.
+ * 
+ * @param pn page number.
+ * @return Span<uint32_t> view into the story graph.
+ */
+Span<uint32_t> Story::getPageChoices(size_t pn) const{
+    return graph.getChoices(pn);
+}
+
+/**
+ * @brief get the story graph.
+ * 
+ * @return const StoryGraph& choices and pages referenced.
+ */
+const StoryGraph & Story::getGraph() const{
+    return graph;
+}
+
+/**
+ * @brief get a page exactly as ReaderSession::printCurrent prints it.
+ * 
+ * @param pn page number.
+ * @return const std::string& the rendered page.
+ */
+const std::string & Story::renderPage(size_t pn) const{
+    return pages.renderPage(pn, graph.getFirstChoice(pn), graph.getChoices(pn).size());
 }
 
 /**
  * @brief check whether the story format.
  * 
  */
-void CYOA::checkPages(){//check referenced relationship, WIN number, LOSE number
+void Story::checkPages(){//check referenced relationship, WIN number, LOSE number
+    STATS_PHASE(STATS_CHECK_PAGES);
     size_t Win_num = 0, Lose_num = 0;
     for(size_t i = 0; i < page_num; ++i){
-        if(pages[i].getType() == "WIN"){
+        PageType type = getPageType(i + 1);
+        if(type == PAGE_WIN){
             ++Win_num;
         }
-        else if(pages[i].getType() == "LOSE"){
+        else if(type == PAGE_LOSE){
             ++Lose_num;
         }
     }
@@ -121,208 +345,379 @@ void CYOA::checkPages(){//check referenced relationship, WIN number, LOSE number
         findError("At least one page must be a WIN page and at least one page must be a LOSE page.");
     }
     for(size_t j = 1; j < page_num; ++j){
-        if(!referenced[j].size()){
+        if(graph.getReferences(j + 1).empty()){
             findError("Every page is referenced by at least one *other* page's choices.");
         }
     }
 } 
 
 /**
- * @brief update the current page.
+ * @brief mark the WIN pages.
  * 
- * @param pn page number.
+ * @return std::vector<bool> whether each page is a WIN page, indexed by page number.
  */
-void CYOA::setCurrent(size_t pn){
-    current_page = &pages[pn - 1];
-    current_choices = pages[pn - 1].getChoices();
+std::vector<bool> Story::getWinPages() const{
+    std::vector<bool> is_win(page_num + 1, false);
+    for(size_t i = 1; i <= page_num; ++i){
+        is_win[i] = getPageType(i) == PAGE_WIN;
+    }
+    return is_win;
 }
 
 /**
- * @brief start the CYOA story.
+ * @brief calculate the reachable page's depth, once; later calls return the
+ * same array. Threads asking at the same time may each compute it, and the
+ * first to finish publishes its array without any lock.
  * 
+ * @return const std::vector<uint32_t>& depth of each page, indexed by page
+ * number; StoryGraph::UNREACHABLE for pages not reachable from page 1.
  */
-void CYOA::readCYOA(){
-    current_page->printPage();
-    std::string in;
-    int is_over = 0;
-    while(getline(std::cin, in) && is_over == 0){
-        int choice_num = isValidChoice(in);
-        if(!choice_num){
-            std::cout << "That is not a valid choice, please try again" << std::endl;
-            continue;
+const std::vector<uint32_t> & Story::getPageDepth() const{
+    std::vector<uint32_t> * depth = page_depth.load(std::memory_order_acquire);
+    if(depth == NULL){
+        STATS_PHASE(STATS_PAGE_DEPTH);
+        std::vector<uint32_t> * computed = new std::vector<uint32_t>();
+        if(cache == NULL || !cache->loadDepth(*computed)){
+            graph.findDepths(*computed, thread_num);
+            if(cache != NULL){
+                cache->saveDepth(*computed);
+            }
         }
-        setCurrent(choice_num);
-        current_page->printPage();
-        if(current_page->getType() == "WIN" || current_page->getType() == "LOSE"){
-            is_over = 1;
-            break;
+        if(page_depth.compare_exchange_strong(depth, computed, std::memory_order_acq_rel)){
+            depth = computed;
+        }
+        else{
+            delete computed; // depth is the array published meanwhile
         }
     }
+    return *depth;
 }
 
 /**
- * @brief calculate the reachable page's depth.
+ * @brief print the page depth.
  * 
- * @return std::map<size_t, size_t> page depth result.
  */
-std::map<size_t, size_t> CYOA::getPageDepth(){
-    std::queue<size_t> waiting_do;
-    std::map<size_t, size_t> page_depth; // (page num, page depth)
-
-    size_t current_index = 1; // page 1
-    size_t current_depth = 0;
-    waiting_do.push(current_index); // push page 1 into container
-    page_depth[current_index] = current_depth;
-
-    while(!waiting_do.empty()){
-        current_index = waiting_do.front();
-        waiting_do.pop();
-        
-        std::vector<size_t> options = pages[current_index - 1].getChoices();
-        current_depth = page_depth[current_index] + 1;
-        for(size_t i = 0; i < options.size(); ++i){
-            if(!page_depth.count(options[i])){ // if not yet visited
-                page_depth[options[i]] = current_depth;
-                waiting_do.push(options[i]);
-            }
+void Story::printDepth() const{
+    const std::vector<uint32_t> & depth = getPageDepth();
+    STATS_PHASE(STATS_OUTPUT);
+    OutputBuffer out;
+    for(size_t i = 1; i <= page_num; ++i){
+        out.write("Page ");
+        out.writeNumber(i);
+        if(depth[i] != StoryGraph::UNREACHABLE){
+            out.writeChar(':');
+            out.writeNumber(depth[i]);
+            out.writeChar('\n');
+        }
+        else{
+            out.write(" is not reachable\n");
         }
     }
-    return page_depth;
 }
 
 /**
- * @brief print the page depth.
+ * @brief check whether has at least one reachable win result: whether a WIN
+ * page can be reached from page 1.
  * 
+ * @return true yes, it has.
+ * @return false no way to win.
  */
-void CYOA::printDepth(){
-    std::map<size_t, size_t> page_depth = getPageDepth();
-    std::map<size_t, size_t>::iterator it;
+bool Story::hasWin() const{
+    return page_num > 0 && canWin(1);
+}
 
-    for(size_t i = 0; i < page_num; ++i){
-        std::cout << "Page " << i+1;
-        it = page_depth.find(i+1);
-        if(it != page_depth.end()){
-           std::cout << ":" << it->second << std::endl;             
+/**
+ * @brief find the pages from which a WIN page can be reached, once, as
+ * getPageDepth finds the depths: the first thread to finish publishes its
+ * array.
+ * 
+ * @return const std::vector<bool>& whether a WIN page can be reached from
+ * each page, indexed by page number.
+ */
+const std::vector<bool> & Story::getWinnable() const{
+    std::vector<bool> * winnable = can_win.load(std::memory_order_acquire);
+    if(winnable == NULL){
+        std::vector<bool> * computed = new std::vector<bool>();
+        graph.findWinnable(getWinPages(), *computed);
+        if(can_win.compare_exchange_strong(winnable, computed, std::memory_order_acq_rel)){
+            winnable = computed;
         }
         else{
-            std::cout<< " is not reachable" << std::endl;
+            delete computed; // winnable is the array published meanwhile
         }
     }
+    return *winnable;
 }
 
 /**
- * @brief check whether has at least one reachable win result.
+ * @brief check whether a WIN page can be reached from a page.
  * 
- * @return true yes, it has.
- * @return false no way to win.
+ * @param pn page number.
+ * @return true some route from the page ends on a WIN page.
+ * @return false every route from it ends on a LOSE page or loops.
  */
-bool CYOA::hasWin(){
-    std::map<size_t, size_t> page_depth = getPageDepth();
-    std::map<size_t, size_t>::iterator it;
-    size_t win_reachable = 0;
+bool Story::canWin(size_t pn) const{
+    return getWinnable()[pn];
+}
 
-    for(size_t i = 0; i < page_num; ++i){
-        it = page_depth.find(i+1);
-        if(it != page_depth.end()){ // this page is reachable
-            if(pages[i].getType() == "WIN"){ // a reachable WIN page
-                ++win_reachable;
-            }
-        }
+/**
+ * @brief get the WIN way: every route from page 1 to a WIN page that never
+ * visits a page twice, last choice explored first. With several threads the
+ * search tree is split between them, and the routes still come out in the
+ * same order.
+ * 
+ * @return std::vector<std::vector<std::pair<size_t, size_t> > > the WIN way result(s).
+ */
+std::vector<std::vector<std::pair<size_t, size_t> > > Story::getWinRoute() const{
+    if(hasWin() == false){ // this story has no reachable WIN page
+        std::cout << "This story is unwinnable!" <<std::endl;
+        exit(EXIT_SUCCESS);
     }
-
-    if(win_reachable == 0){
-        return false;
+    STATS_PHASE(STATS_WIN_ROUTE);
+    std::vector<std::vector<std::pair<size_t, size_t> > > paths; // all win path
+    if(cache != NULL && cache->loadRoutes(paths)){
+        return paths;
+    }
+    std::vector<bool> is_win = getWinPages();
+    RouteSearch search(graph, is_win, getWinnable(), thread_num);
+    search.run(paths);
+    if(cache != NULL){
+        cache->saveRoutes(paths);
     }
-    return true;
+    return paths;
 }
 
 /**
- * @brief check whether the page in the reading path.
+ * @brief print WIN ways, one per line: "page(choice),...,page(win)".
  * 
- * @param current_path the pages have been read
- * @param page page is to be checked
- * @return true the page is in the path
- * @return false the page isn't in the path
+ * @param paths the WIN ways.
  */
-bool CYOA::hasPage(std::vector<std::pair<size_t, size_t> > current_path, size_t page){
-    std::vector<std::pair<size_t, size_t> >::iterator it;
-    for(it = current_path.begin(); it != current_path.end(); ++it){
-        if(page == it->first){
-            return true;
+static void printRoutes(const std::vector<std::vector<std::pair<size_t, size_t> > > & paths){
+    STATS_PHASE(STATS_OUTPUT);
+    OutputBuffer out;
+    size_t i = 0, j = 0;
+    for(i = 0; i < paths.size(); ++i){
+        for(j = 0; j < paths[i].size() - 1; ++j){
+            out.writeNumber(paths[i][j].first);
+            out.writeChar('(');
+            out.writeNumber(paths[i][j].second);
+            out.write("),");
         }
+        out.writeNumber(paths[i][j].first);
+        out.write("(win)\n");
     }
-    return false;
 }
 
 /**
- * @brief get the WIN way.
+ * @brief print all the WIN way.
  * 
- * @return std::vector<std::vector<std::pair<size_t, size_t> > > the WIN way result(s).
  */
-std::vector<std::vector<std::pair<size_t, size_t> > > CYOA::getWinRoute(){
+void Story::printStrategy() const{
+    printRoutes(getWinRoute());
+}
+
+/**
+ * @brief get up to k shortest WIN ways: fewest choices first, and among
+ * routes as long, the one taking the lower choice number first. Only the
+ * routes returned and their deviations are searched, so the number of
+ * routes in all doesn't matter.
+ * 
+ * @param k the number of routes wanted.
+ * @return std::vector<std::vector<std::pair<size_t, size_t> > > the routes,
+ * in the format of getWinRoute.
+ */
+std::vector<std::vector<std::pair<size_t, size_t> > > Story::getShortestRoutes(size_t k) const{
     if(hasWin() == false){ // this story has no reachable WIN page
         std::cout << "This story is unwinnable!" <<std::endl;
         exit(EXIT_SUCCESS);
     }
-    std::vector<std::pair<size_t, size_t> > current_path; //(page num, choice num)
-    std::vector<std::vector<std::pair<size_t, size_t> > > paths; // all win path
-    std::stack<std::pair<size_t, size_t> > waiting_do;
-    std::map<size_t, size_t> subroute_num;
-
-    size_t current_index = 1;
-    waiting_do.push(std::pair<size_t, size_t>(current_index,0));
-    while(!waiting_do.empty()){
-        std::pair<size_t, size_t> current_p = waiting_do.top();
-        current_index = current_p.first;
-        waiting_do.pop();
-        if(!current_path.empty()){ //B assigns the second value of the preceding node A of the path.
-            current_path[current_path.size() - 1].second = current_p.second;
-        }
+    STATS_PHASE(STATS_WIN_ROUTE);
+    std::vector<bool> is_win = getWinPages();
+    ShortestRoutes search(graph, is_win, getWinnable());
+    std::vector<std::vector<std::pair<size_t, size_t> > > paths;
+    search.find(k, paths);
+    return paths;
+}
 
-        if(hasPage(current_path, current_index) == false){ // The node to be queried is not in the current path
-            current_path.push_back(current_p); // Add to current path
-            std::vector<size_t> options = pages[current_index - 1].getChoices(); // Get options for the current node
-            size_t options_num = options.size();
-            subroute_num[current_index] = options_num; // Records how many children of the current node need to be traversed
+/**
+ * @brief print up to k shortest WIN ways, shortest first.
+ * 
+ * @param k the number of routes wanted.
+ */
+void Story::printShortest(size_t k) const{
+    printRoutes(getShortestRoutes(k));
+}
 
-            if(options_num == 0){ // If the end of the current path is a WIN page
-                if(pages[current_index - 1].getType() == "WIN"){
-                    paths.push_back(current_path); //add the current path to the result container
-                }
-            }
-            else{ // Adds a child page at the end of the current path
-                for(size_t i = 0; i < options.size(); ++i){
-                    waiting_do.push(std::pair<size_t, size_t>(options[i], i + 1)); //(page num, choice num)
-                }
-            }
+/**
+ * @brief print the number of WIN ways, in total and through each page,
+ * without listing them.
+ * 
+ */
+void Story::printCount() const{
+    if(hasWin() == false){ // this story has no reachable WIN page
+        std::cout << "This story is unwinnable!" <<std::endl;
+        exit(EXIT_SUCCESS);
+    }
+    std::vector<bool> is_win = getWinPages();
+    RouteCounter counter(graph, is_win);
+    {
+        STATS_PHASE(STATS_COUNT_ROUTES);
+        counter.count();
+    }
 
-        }
-        if(current_path.empty()){
-            break;
-        }
-        size_t last_page = current_path.back().first;
-        while(subroute_num[last_page] == 0 && current_path.size() > 1){
-            current_path.pop_back(); // The "leaf" page is deleted from the current path
-            if(!current_path.empty()){
-                last_page = current_path.back().first;
-                subroute_num[last_page] --;
-            }
-        }
+    STATS_PHASE(STATS_OUTPUT);
+    OutputBuffer out;
+    out.write("Winning routes:");
+    out.write(counter.getTotal().toString());
+    out.writeChar('\n');
+    for(size_t i = 1; i <= page_num; ++i){
+        out.write("Page ");
+        out.writeNumber(i);
+        out.writeChar(':');
+        out.write(counter.getThrough(i).toString());
+        out.writeChar('\n');
     }
-    return paths;
 }
 
 /**
- * @brief print all the WIN way.
+ * @brief print the structure of the story as one JSON object: its loops, the
+ * immediate dominator of each page, the pages every route to each WIN page
+ * goes through, and the pages every WIN way goes through. It takes
+ * near-linear time, however many WIN ways there are.
  * 
  */
-void CYOA::printStrategy(){
-    std::vector<std::vector<std::pair<size_t, size_t> > > paths = getWinRoute();
-    size_t i = 0, j = 0;
-    for(i = 0; i < paths.size(); ++i){
-        for(j = 0; j < paths[i].size() - 1; ++j){
-            std::cout<< paths[i][j].first << "(" <<paths[i][j].second << "),";
+void Story::printStructure() const{
+    std::vector<bool> is_win = getWinPages();
+    StoryStructure structure(graph, is_win);
+    {
+        STATS_PHASE(STATS_STRUCTURE);
+        structure.analyze();
+    }
+
+    STATS_PHASE(STATS_OUTPUT);
+    std::string summary;
+    structure.appendSummary(summary);
+    OutputBuffer out;
+    out.write(summary);
+}
+
+// ===================================================
+
+//                  ReaderSession Class
+
+// ===================================================
+/**
+ * @brief Construct a new ReaderSession::ReaderSession object
+ * 
+ * @param story the story read; it must outlive the session.
+ */
+ReaderSession::ReaderSession(const Story & story): story(story), current_page(0), current_choices() {
+    setCurrent(1);
+}
+
+/**
+ * @brief get the current page number.
+ * 
+ * @return size_t page number.
+ */
+size_t ReaderSession::getPage() const{
+    return current_page;
+}
+
+/**
+ * @brief get the current page exactly as printCurrent prints it.
+ * 
+ * @return const std::string& the rendered page, shared with other sessions.
+ */
+const std::string & ReaderSession::renderCurrent() const{
+    return story.renderPage(current_page);
+}
+
+/**
+ * @brief check whether the user's input is valid.
+ * 
+ * @param choice choice description
+ * @return int if valid, return positive number.
+ */
+int ReaderSession::isValidChoice(const std::string choice) const{
+    size_t choice_num = Page::isPositiveNum(choice); // number > 0 ?
+    if(choice_num > 0 && choice_num <= current_choices.size()){ // The number is greater than 0 and it's in the options
+        return current_choices[choice_num - 1]; // every choice was checked to be within the page range on loading
+    }
+    return 0; //  Otherwise, it is invalid.
+}
+
+/**
+ * @brief update the current page.
+ * 
+ * @param pn page number.
+ */
+void ReaderSession::setCurrent(size_t pn){
+    current_page = pn;
+    current_choices = story.getPageChoices(pn);
+}
+
+/**
+ * @brief check whether the current page ends the story.
+ * 
+ * @return true it is a WIN or LOSE page.
+ * @return false the reader has choices left.
+ */
+bool ReaderSession::isOver() const{
+    PageType type = story.getPageType(current_page);
+    return type == PAGE_WIN || type == PAGE_LOSE;
+}
+
+/**
+ * @brief print the current page.
+ * 
+ * @param out the output.
+ */
+void ReaderSession::printCurrent(OutputBuffer & out) const{
+    out.write(renderCurrent());
+}
+
+/**
+ * @brief start the CYOA story.
+ * 
+ */
+void ReaderSession::readCYOA(){
+    OutputBuffer out;
+    play(std::cin, out, true);
+}
+
+/**
+ * @brief play the story from the current page with the reader's input,
+ * printing exactly what readCYOA prints.
+ * 
+ * @param input the reader's input lines.
+ * @param out the output.
+ * @param interactive flush the output whenever the reader is asked for input.
+ */
+void ReaderSession::play(std::istream & input, OutputBuffer & out, bool interactive){
+    printCurrent(out);
+    if(interactive){
+        out.flush();
+    }
+    std::string in;
+    int is_over = 0;
+    while(getline(input, in) && is_over == 0){
+        int choice_num = isValidChoice(in);
+        if(!choice_num){
+            out.write("That is not a valid choice, please try again\n");
+            if(interactive){
+                out.flush();
+            }
+            continue;
+        }
+        setCurrent(choice_num);
+        printCurrent(out);
+        if(interactive){
+            out.flush();
+        }
+        if(isOver()){
+            is_over = 1;
+            break;
         }
-        std::cout << paths[i][j].first << "(win)" << std::endl;
     }
 }
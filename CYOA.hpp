@@ -1,3 +1,6 @@
+#ifndef CYOA_HPP
+#define CYOA_HPP
+
 #include <iostream>
 #include <cstdlib>
 #include <cstdio>
@@ -8,22 +11,39 @@
 #include <string>
 #include <queue>
 #include <stack>
+#include <atomic>
+#include "AnalysisCache.hpp"
+#include "EmbeddedStory.hpp"
+#include "Output.hpp"
 #include "Page.hpp"
+#include "StoryFile.hpp"
+#include "StoryGraph.hpp"
+#include "StoryPages.hpp"
 
-class CYOA{
+// a loaded story. Once constructed it is never changed, so any number of
+// threads may read it at once; readers keep their place in a ReaderSession.
+class Story{
 public:
     // default constructor
-    CYOA();
-    // constructor
-    CYOA(const std::string directory_name);
+    Story();
+    // constructor: a story directory or a compiled story file, worked on by up to thread_num threads,
+    // or by a default number for each phase for 0.
+    // Without lazy_text, page texts are read with the pages; with it, only when a page is printed.
+    // Without check_pages, the caller runs checkPages itself.
+    Story(const std::string directory_name, size_t thread_num = 1, bool lazy_text = false, bool check_pages = true);
+    // constructor: a story built into the program by cyoa-embed, checked when it was compiled.
+    Story(const EmbeddedStory & embedded, size_t thread_num = 1);
     // destructor
-    ~CYOA();
+    ~Story();
     
     // get each page file name.
-    std::string getFileName(const std::string dir, int num);
+    static std::string getFileName(const std::string dir, size_t num);
+
+    // get the page number a file name stands for, or 0 if it is no page file name.
+    static size_t pageFileNumber(const char * name);
 
-    // check whether the named file exist.
-    bool hasFile(const std::string & filename);
+    // list the story's page files with a single pass over the directory.
+    static std::vector<std::string> scanPages(const std::string & dir);
 
     // add the referenced relationship.
     void addReferenced(Page & page);
@@ -31,41 +51,121 @@ public:
     // handler to store all valid pages in story.
     void savePages(const std::string & dir);
 
-    // check whether the user's input is valid.
-    int isValidChoice(const std::string choice);
+    // map a compiled story instead of reading the pages.
+    void loadCompiled(const std::string & file_name);
 
-    // check whether the story format.
-    void checkPages(); //referenced relationship, WIN, LOSE
+    // keep the depths and WIN routes in a cache directory; call before any analysis.
+    void useCache(const std::string & cache_dir);
 
-    // update the current page.
-    void setCurrent(size_t pn);
+    // write the story as a compiled story file.
+    void compile(const std::string & file_name) const;
 
-    // start the CYOA story.
-    void readCYOA();
+    // write the story as a header of constexpr tables, in the namespace name.
+    void embed(const std::string & file_name, const std::string & name) const;
+
+    // get the page type.
+    PageType getPageType(size_t pn) const;
+
+    // get the optional page numbers of a page.
+    Span<uint32_t> getPageChoices(size_t pn) const;
+
+    // get the story graph.
+    const StoryGraph & getGraph() const;
+
+    // mark the WIN pages.
+    std::vector<bool> getWinPages() const;
+
+    // get a page exactly as it is printed.
+    const std::string & renderPage(size_t pn) const;
+
+    // check whether the story format.
+    void checkPages(); //referenced relationship, WIN, LOSE
 
     // calculate the reachable page's depth.
-    std::map<size_t, size_t> getPageDepth();
+    const std::vector<uint32_t> & getPageDepth() const;
 
     // print the page depth.
-    void printDepth();
+    void printDepth() const;
 
     // check whether has at least one reachable win result.
-    bool hasWin();
+    bool hasWin() const;
+
+    // find the pages from which a WIN page can be reached, once.
+    const std::vector<bool> & getWinnable() const;
 
-    // check whether the page in the reading path.
-    bool hasPage(std::vector<std::pair<size_t, size_t> > current_path, size_t page);
+    // check whether a WIN page can be reached from a page.
+    bool canWin(size_t pn) const;
 
     // get the WIN way.
-    std::vector<std::vector<std::pair<size_t, size_t> > > getWinRoute();
+    std::vector<std::vector<std::pair<size_t, size_t> > > getWinRoute() const;
 
     // print all the WIN way.
-    void printStrategy();
+    void printStrategy() const;
+
+    // get up to k shortest WIN ways, without listing all of them.
+    std::vector<std::vector<std::pair<size_t, size_t> > > getShortestRoutes(size_t k) const;
+
+    // print up to k shortest WIN ways, shortest first.
+    void printShortest(size_t k) const;
+
+    // print the number of WIN ways, in total and through each page.
+    void printCount() const;
+
+    // print the loops, the dominator tree and the pages on every WIN way, as JSON.
+    void printStructure() const;
 
 private:
+    Story(const Story &);
+    Story & operator=(const Story &);
+
     std::string story_name; // story name
+    size_t thread_num; // worker threads for loading and route search
+    size_t read_threads; // threads reading page files without io_uring, 0 for the loader's default
+    bool lazy_text; // read page texts only when a page is printed
     size_t page_num; // total valid pages number in the story
-    std::vector<Page> pages; // all valid pages in the stroy
-    Page *current_page; // current page
-    std::vector<size_t> current_choices; // current optional page numbers
-    std::vector<std::vector<size_t> > referenced; // pages referenced
+    StoryFile compiled; // the mapped story, when loaded from a compiled file
+    StoryPages pages; // types, texts and choice labels of all valid pages in the story
+    StoryGraph graph; // choices and pages referenced
+    mutable std::atomic<std::vector<uint32_t> *> page_depth; // depth of each page, computed once
+    mutable std::atomic<std::vector<bool> *> can_win; // pages reaching a WIN page, computed once
+    AnalysisCache * cache; // results of earlier runs, or NULL
 };
+
+// one reader's place in a story: the current page and a view of its choices
+// into the story graph.
+class ReaderSession{
+public:
+    // constructor: the reader starts on page 1.
+    ReaderSession(const Story & story);
+
+    // get the current page number.
+    size_t getPage() const;
+
+    // get the current page exactly as it is printed.
+    const std::string & renderCurrent() const;
+
+    // check whether the user's input is valid.
+    int isValidChoice(const std::string choice) const;
+
+    // update the current page.
+    void setCurrent(size_t pn);
+
+    // check whether the current page ends the story.
+    bool isOver() const;
+
+    // print the current page.
+    void printCurrent(OutputBuffer & out) const;
+
+    // start the CYOA story.
+    void readCYOA();
+
+    // play the story with the reader's input, printing what readCYOA prints.
+    void play(std::istream & input, OutputBuffer & out, bool interactive);
+
+private:
+    const Story & story; // the story read
+    uint32_t current_page; // current page number
+    Span<uint32_t> current_choices; // current optional page numbers
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "EmbeddedStory.hpp"
+#include "Output.hpp"
+
+#include <cctype>
+#include <fstream>
+
+/**
+ * @brief append a C++ array definition of numbers, twenty to a line.
+ * 
+ * @param type element type.
+ * @param name array name.
+ * @param values the numbers.
+ * @param count number of values; an array is never empty, so a 0 is added
+ * when there are none.
+ * @param out the definition is appended here.
+ */
+template<typename T>
+static void appendArray(const char * type, const char * name, const T * values, size_t count, std::string & out){
+    out += "constexpr ";
+    out += type;
+    out += ' ';
+    out += name;
+    out += "[] = {";
+    for(size_t i = 0; i < count; ++i){
+        out += i % 20 == 0? "\n    " : " ";
+        appendNumber(out, values[i]);
+        out += ',';
+    }
+    if(count == 0){
+        out += "\n    0, // no values";
+    }
+    out += "\n};\n";
+}
+
+/**
+ * @brief append bytes as a C++ string literal, one literal per text line.
+ * Octal escapes always have three digits, so a digit after one is never
+ * taken as part of it.
+ * 
+ * @param data the bytes.
+ * @param size number of bytes.
+ * @param out the literal is appended here.
+ */
+static void appendLiteral(const char * data, size_t size, std::string & out){
+    out += "\n    \"";
+    for(size_t i = 0; i < size; ++i){
+        unsigned char c = data[i];
+        if(c == '\n'){
+            out += "\\n\"";
+            if(i + 1 < size){
+                out += "\n    \"";
+            }
+            continue;
+        }
+        if(c == '"' || c == '\\' || c == '?'){
+            out += '\\';
+            out += c;
+        }
+        else if(c < 0x20 || c >= 0x7f){
+            out += '\\';
+            out += '0' + (c >> 6);
+            out += '0' + ((c >> 3) & 7);
+            out += '0' + (c & 7);
+        }
+        else{
+            out += c;
+        }
+    }
+    if(size == 0 || data[size - 1] != '\n'){
+        out += '"';
+    }
+}
+
+/**
+ * @brief write a story as a C++ header: its tables as constexpr arrays in a
+ * namespace, an EmbeddedStory named STORY over them, and the static_asserts
+ * checking the story as checkPages would, so a broken story fails the build.
+ * For each page after page 1, the first page choosing it is written as its
+ * witness.
+ * 
+ * @param file_name the output header.
+ * @param name the namespace of the tables.
+ * @param pages the story's pages, with their texts.
+ * @param graph the story's choices.
+ */
+void writeEmbeddedStory(const std::string & file_name, const std::string & name, const StoryPages & pages, const StoryGraph & graph){
+    size_t page_num = pages.getPageNum(), choice_num = pages.getChoiceNum();
+    std::vector<uint32_t> choice_index(page_num + 1), targets;
+    std::vector<uint32_t> witness_pages(page_num, 0), witness_choices(page_num, 0);
+    targets.reserve(choice_num);
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        choice_index[pn - 1] = targets.size();
+        Span<uint32_t> options = graph.getChoices(pn);
+        targets.insert(targets.end(), options.begin(), options.end());
+    }
+    choice_index[page_num] = targets.size();
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        Span<uint32_t> sources = graph.getReferences(pn);
+        if(sources.empty()){
+            continue; // left 0, so the static_assert fails
+        }
+        uint32_t source = sources[0];
+        size_t c = choice_index[source - 1];
+        while(targets[c] != pn){
+            ++c;
+        }
+        witness_pages[pn - 1] = source;
+        witness_choices[pn - 1] = c;
+    }
+    Span<char> arena = pages.getArena();
+
+    std::string guard;
+    for(size_t i = 0; i < name.size(); ++i){
+        guard += toupper((unsigned char)name[i]);
+    }
+    guard += "_HPP";
+    std::string out = "// written by cyoa-embed; do not edit.\n#ifndef " + guard + "\n#define " + guard + "\n\n";
+    out += "#include \"EmbeddedStory.hpp\"\n\nnamespace " + name + "{\n\n";
+    appendArray("uint8_t", "TYPES", pages.getTypes(), page_num, out);
+    appendArray("uint32_t", "CHOICE_INDEX", choice_index.data(), page_num + 1, out);
+    appendArray("uint32_t", "TARGETS", targets.data(), choice_num, out);
+    appendArray("uint64_t", "LABELS", pages.getLabelOffsets(), choice_num + 1, out);
+    appendArray("uint64_t", "TEXTS", pages.getTextOffsets(), page_num + 1, out);
+    appendArray("uint32_t", "WITNESS_PAGES", witness_pages.data(), page_num, out);
+    appendArray("uint32_t", "WITNESS_CHOICES", witness_choices.data(), page_num, out);
+    out += "constexpr char ARENA[] =";
+    appendLiteral(arena.begin(), arena.size(), out);
+    out += ";\n\nconstexpr EmbeddedStory STORY = {\n    ";
+    appendNumber(out, page_num);
+    out += ", ";
+    appendNumber(out, choice_num);
+    out += ", TYPES, CHOICE_INDEX, TARGETS, LABELS, TEXTS, ARENA, sizeof(ARENA) - 1, WITNESS_PAGES, WITNESS_CHOICES\n};\n\n";
+    out += "static_assert(embedded::isWellFormed(STORY), \"The embedded story tables are broken!\");\n";
+    out += "static_assert(!embedded::isWellFormed(STORY) || embedded::choicesInBound(STORY), \"There is a page number out of bound!\");\n";
+    out += "static_assert(!embedded::isWellFormed(STORY) || embedded::pageTypesMatch(STORY), \"It's a mix type page, illegal!\");\n";
+    out += "static_assert(!embedded::isWellFormed(STORY) || embedded::hasWinAndLose(STORY), "
+           "\"At least one page must be a WIN page and at least one page must be a LOSE page.\");\n";
+    out += "static_assert(!embedded::isWellFormed(STORY) || !embedded::choicesInBound(STORY) || embedded::everyPageReferenced(STORY), "
+           "\"Every page is referenced by at least one *other* page's choices.\");\n";
+    out += "\n}\n\n#endif\n";
+
+    std::ofstream file(file_name.c_str(), std::ios::binary);
+    file << out;
+    file.close();
+    if(!file){
+        findError("The header cannot be written!");
+    }
+}
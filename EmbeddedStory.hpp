@@ -0,0 +1,115 @@
+#ifndef EMBEDDED_STORY_HPP
+#define EMBEDDED_STORY_HPP
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include "Page.hpp"
+#include "StoryGraph.hpp"
+#include "StoryPages.hpp"
+
+// a story built into the program: the arrays of a compiled story file (see
+// StoryFileHeader) as constexpr tables in a header written by cyoa-embed.
+// witness_pages and witness_choices name, for each page after page 1, one
+// choice leading to it, so the compiler can check every page is referenced
+// in linear time.
+struct EmbeddedStory{
+    size_t page_num;
+    size_t choice_num;
+    const uint8_t * types; // PageType of each page
+    const uint32_t * choice_index; // index of each page's first choice, plus the end
+    const uint32_t * targets; // page number each choice leads to
+    const uint64_t * labels; // arena offset of each choice label, plus the end
+    const uint64_t * texts; // arena offset of each page's text, plus the end
+    const char * arena;
+    size_t arena_size;
+    const uint32_t * witness_pages; // a page choosing each page, by page number - 1
+    const uint32_t * witness_choices; // the index of that choice
+};
+
+// write a story as a header defining an EmbeddedStory and the static_asserts checking it.
+void writeEmbeddedStory(const std::string & file_name, const std::string & name, const StoryPages & pages, const StoryGraph & graph);
+
+// the checks of checkPages and of the page format that the tables can show,
+// as constexpr functions for static_assert. Every check over a range splits
+// it in halves, so the recursion depth stays logarithmic.
+namespace embedded{
+
+// the offsets values[lo] ... values[hi] never decrease.
+template<typename T>
+constexpr bool ascending(const T * values, size_t lo, size_t hi){
+    return hi - lo <= 1? hi == lo || values[lo] <= values[hi]
+        : ascending(values, lo, lo + (hi - lo) / 2) && ascending(values, lo + (hi - lo) / 2, hi);
+}
+
+// the choice index and the label and text offsets are well formed.
+constexpr bool isWellFormed(const EmbeddedStory & story){
+    return story.page_num > 0 && story.choice_index[0] == 0 && story.choice_index[story.page_num] == story.choice_num
+        && ascending(story.choice_index, 0, story.page_num)
+        && story.labels[0] == 0 && ascending(story.labels, 0, story.choice_num)
+        && story.texts[0] == story.labels[story.choice_num] && ascending(story.texts, 0, story.page_num)
+        && story.texts[story.page_num] == story.arena_size;
+}
+
+// every choice of choices lo ... hi - 1 leads to a page of the story.
+constexpr bool inBound(const EmbeddedStory & story, size_t lo, size_t hi){
+    return hi - lo <= 1? hi == lo || (story.targets[lo] >= 1 && story.targets[lo] <= story.page_num)
+        : inBound(story, lo, lo + (hi - lo) / 2) && inBound(story, lo + (hi - lo) / 2, hi);
+}
+
+// every choice leads to a page of the story.
+constexpr bool choicesInBound(const EmbeddedStory & story){
+    return inBound(story, 0, story.choice_num);
+}
+
+// a page is a choice page exactly when it has choices.
+constexpr bool typeMatches(const EmbeddedStory & story, size_t i){
+    return story.types[i] <= PAGE_NOTYPE
+        && (story.types[i] == PAGE_CHOICE) == (story.choice_index[i + 1] > story.choice_index[i]);
+}
+
+// pages lo + 1 ... hi have the choices their types allow.
+constexpr bool typesMatch(const EmbeddedStory & story, size_t lo, size_t hi){
+    return hi - lo <= 1? hi == lo || typeMatches(story, lo)
+        : typesMatch(story, lo, lo + (hi - lo) / 2) && typesMatch(story, lo + (hi - lo) / 2, hi);
+}
+
+// no page mixes types.
+constexpr bool pageTypesMatch(const EmbeddedStory & story){
+    return typesMatch(story, 0, story.page_num);
+}
+
+// the number of pages lo + 1 ... hi of a type.
+constexpr size_t countType(const EmbeddedStory & story, size_t lo, size_t hi, PageType type){
+    return hi - lo <= 1? (hi > lo && story.types[lo] == type? 1 : 0)
+        : countType(story, lo, lo + (hi - lo) / 2, type) + countType(story, lo + (hi - lo) / 2, hi, type);
+}
+
+// at least one page is a WIN page and at least one is a LOSE page.
+constexpr bool hasWinAndLose(const EmbeddedStory & story){
+    return countType(story, 0, story.page_num, PAGE_WIN) > 0 && countType(story, 0, story.page_num, PAGE_LOSE) > 0;
+}
+
+// the witness of page i + 1 is a choice leading to it. As in checkPages, a
+// page choosing itself counts.
+constexpr bool witnessed(const EmbeddedStory & story, size_t i){
+    return story.witness_pages[i] >= 1 && story.witness_pages[i] <= story.page_num
+        && story.choice_index[story.witness_pages[i] - 1] <= story.witness_choices[i]
+        && story.witness_choices[i] < story.choice_index[story.witness_pages[i]]
+        && story.targets[story.witness_choices[i]] == i + 1;
+}
+
+// pages lo + 1 ... hi are referenced by choices.
+constexpr bool referenced(const EmbeddedStory & story, size_t lo, size_t hi){
+    return hi - lo <= 1? hi == lo || witnessed(story, lo)
+        : referenced(story, lo, lo + (hi - lo) / 2) && referenced(story, lo + (hi - lo) / 2, hi);
+}
+
+// every page after page 1 is referenced by a page's choices.
+constexpr bool everyPageReferenced(const EmbeddedStory & story){
+    return referenced(story, 1, story.page_num);
+}
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "Options.hpp"
+#include "Page.hpp"
+
+/**
+ * @brief Construct a new Options object
+ * 
+ * @param argc argument number.
+ * @param argv arguments, including the program name.
+ */
+Options::Options(int argc, char** argv): args(argv, argv + argc) {}
+
+/**
+ * @brief take an option without value.
+ * 
+ * @param name e.g. "--count".
+ * @return true the option was given.
+ * @return false it wasn't.
+ */
+bool Options::takeFlag(const std::string & name){
+    bool found = false;
+    for(size_t i = 1; i < args.size(); ){
+        if(args[i] == name){
+            args.erase(args.begin() + i);
+            found = true;
+        }
+        else{
+            ++i;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief take an option with a value.
+ * 
+ * @param short_name e.g. "-j", accepted as "-j 4" and "-j4"; "" if there is none.
+ * @param long_name e.g. "--threads", accepted as "--threads 4" and "--threads=4".
+ * @param value set to the value of the last occurrence.
+ * @return true the option was given.
+ * @return false it wasn't; value is unchanged.
+ */
+bool Options::takeValue(const std::string & short_name, const std::string & long_name, std::string & value){
+    bool found = false;
+    for(size_t i = 1; i < args.size(); ){
+        std::string text;
+        size_t taken = 1;
+        if(args[i] == short_name || args[i] == long_name){
+            if(i + 1 == args.size()){
+                findError("Option " + args[i] + " needs a value!");
+            }
+            text = args[i + 1];
+            taken = 2;
+        }
+        else if(!short_name.empty() && args[i].compare(0, short_name.size(), short_name) == 0 && args[i].size() > short_name.size()){
+            text = args[i].substr(short_name.size());
+        }
+        else if(args[i].compare(0, long_name.size() + 1, long_name + "=") == 0){
+            text = args[i].substr(long_name.size() + 1);
+        }
+        else{
+            ++i;
+            continue;
+        }
+        value = text;
+        found = true;
+        args.erase(args.begin() + i, args.begin() + i + taken);
+    }
+    return found;
+}
+
+/**
+ * @brief take an option with a positive number value.
+ * 
+ * @param short_name e.g. "-j", accepted as "-j 4" and "-j4"; "" if there is none.
+ * @param long_name e.g. "--threads", accepted as "--threads 4" and "--threads=4".
+ * @param default_value the value when the option is absent.
+ * @return size_t the value of the last occurrence.
+ */
+size_t Options::takeNumber(const std::string & short_name, const std::string & long_name, size_t default_value){
+    std::string text;
+    if(!takeValue(short_name, long_name, text)){
+        return default_value;
+    }
+    size_t value = Page::isPositiveNum(text);
+    if(value == 0){
+        findError("Option " + long_name + " needs a positive number!");
+    }
+    return value;
+}
+
+/**
+ * @brief take an option with a percentage value, 0 to 100.
+ * 
+ * @param long_name e.g. "--cycles", accepted as "--cycles 10" and "--cycles=10".
+ * @param default_value the value when the option is absent.
+ * @return size_t the value of the last occurrence.
+ */
+size_t Options::takePercent(const std::string & long_name, size_t default_value){
+    std::string text;
+    if(!takeValue("", long_name, text)){
+        return default_value;
+    }
+    if(text.empty() || text.size() > 3 || text.find_first_not_of("0123456789") != std::string::npos
+       || atoi(text.c_str()) > 100){
+        findError("Option " + long_name + " needs a percentage!");
+    }
+    return atoi(text.c_str());
+}
+
+/**
+ * @brief check the number of arguments left, counting the program name like
+ * argc. Anything still looking like an option is unknown.
+ * 
+ * @param want_argc wanna number.
+ */
+void Options::argumentCheck(size_t want_argc){
+    for(size_t i = 1; i < args.size(); ++i){
+        if(args[i].size() > 1 && args[i][0] == '-'){
+            findError("Unknown option " + args[i] + "!");
+        }
+    }
+    if(args.size() != want_argc){
+        findError("Wrong number of input arguments!");
+    }
+}
+
+/**
+ * @brief get a positional argument.
+ * 
+ * @param i index; 0 is the program name.
+ * @return const std::string& the argument.
+ */
+const std::string & Options::operator[](size_t i) const{
+    return args[i];
+}
+
+/**
+ * @brief get the number of arguments left.
+ * 
+ * @return size_t the number, counting the program name like argc.
+ */
+size_t Options::size() const{
+    return args.size();
+}
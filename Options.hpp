@@ -0,0 +1,39 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+#include <vector>
+
+// command line of a cyoa program: options are taken out one by one, and
+// whatever is left must be the positional arguments.
+class Options{
+public:
+    // constructor
+    Options(int argc, char** argv);
+
+    // take an option without value; true if it was given.
+    bool takeFlag(const std::string & name);
+
+    // take an option with a value ("-j 4", "-j4", "--threads 4", "--threads=4"); true if it was given.
+    bool takeValue(const std::string & short_name, const std::string & long_name, std::string & value);
+
+    // take an option with a positive number value.
+    size_t takeNumber(const std::string & short_name, const std::string & long_name, size_t default_value);
+
+    // take an option with a percentage value, 0 to 100.
+    size_t takePercent(const std::string & long_name, size_t default_value);
+
+    // check the number of arguments left, counting the program name like argc.
+    void argumentCheck(size_t want_argc);
+
+    // get a positional argument; 0 is the program name.
+    const std::string & operator[](size_t i) const;
+
+    // get the number of arguments left, counting the program name like argc.
+    size_t size() const;
+
+private:
+    std::vector<std::string> args; // arguments not taken yet
+};
+
+#endif
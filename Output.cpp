@@ -0,0 +1,181 @@
+#include "Output.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+// "00" ... "99", so numbers are formatted two digits at a time.
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * @brief format a number in decimal.
+ * 
+ * @param value the number.
+ * @param end one past the last byte of a buffer of at least 20 bytes.
+ * @return char* the first digit; the digits run up to end.
+ */
+static char * formatNumber(uint64_t value, char * end){
+    char * p = end;
+    while(value >= 100){
+        size_t pair = (value % 100) * 2;
+        value /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if(value >= 10){
+        *--p = DIGIT_PAIRS[value * 2 + 1];
+        *--p = DIGIT_PAIRS[value * 2];
+    }
+    else{
+        *--p = '0' + value;
+    }
+    return p;
+}
+
+/**
+ * @brief write all bytes to a file descriptor, retrying short writes.
+ * 
+ * @param fd the file descriptor.
+ * @param data the bytes.
+ * @param len number of bytes.
+ * @return true everything was written.
+ * @return false a write failed.
+ */
+static bool writeAll(int fd, const char * data, size_t len){
+    while(len > 0){
+        ssize_t n = ::write(fd, data, len);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief append a number in decimal to a string.
+ * 
+ * @param out the string.
+ * @param value the number.
+ */
+void appendNumber(std::string & out, uint64_t value){
+    char digits[20];
+    char * first = formatNumber(value, digits + sizeof(digits));
+    out.append(first, digits + sizeof(digits) - first);
+}
+
+// ===================================================
+
+//                  OutputBuffer Class
+
+// ===================================================
+/**
+ * @brief Construct a new OutputBuffer::OutputBuffer object. Whatever
+ * std::cout still holds is written first, so the output keeps its order.
+ * 
+ * @param fd the file descriptor written to.
+ * @param capacity bytes collected before a write.
+ */
+OutputBuffer::OutputBuffer(int fd, size_t capacity): fd(fd), buffer(capacity > 32? capacity : 32), used(0), good(true) {
+    std::cout.flush();
+}
+
+/**
+ * @brief Destroy the OutputBuffer::OutputBuffer object, writing what is left.
+ * 
+ */
+OutputBuffer::~OutputBuffer(){
+    flush();
+}
+
+/**
+ * @brief append bytes; blocks larger than the buffer are written directly.
+ * 
+ * @param data the bytes.
+ * @param len number of bytes.
+ */
+void OutputBuffer::write(const char * data, size_t len){
+    if(len > buffer.size() - used){
+        flush();
+        if(len >= buffer.size()){
+            good = writeAll(fd, data, len) && good;
+            return;
+        }
+    }
+    memcpy(buffer.data() + used, data, len);
+    used += len;
+}
+
+/**
+ * @brief append a string.
+ * 
+ * @param str the string.
+ */
+void OutputBuffer::write(const std::string & str){
+    write(str.data(), str.size());
+}
+
+/**
+ * @brief append a C string.
+ * 
+ * @param str the string.
+ */
+void OutputBuffer::write(const char * str){
+    write(str, strlen(str));
+}
+
+/**
+ * @brief append one character.
+ * 
+ * @param c the character.
+ */
+void OutputBuffer::writeChar(char c){
+    if(used == buffer.size()){
+        flush();
+    }
+    buffer[used++] = c;
+}
+
+/**
+ * @brief append a number in decimal.
+ * 
+ * @param value the number.
+ */
+void OutputBuffer::writeNumber(uint64_t value){
+    if(buffer.size() - used < 20){
+        flush();
+    }
+    char * end = buffer.data() + used + 20;
+    char * first = formatNumber(value, end);
+    size_t len = end - first;
+    memmove(buffer.data() + used, first, len);
+    used += len;
+}
+
+/**
+ * @brief write everything appended so far.
+ * 
+ */
+void OutputBuffer::flush(){
+    good = writeAll(fd, buffer.data(), used) && good;
+    used = 0;
+}
+
+/**
+ * @brief check whether every write so far succeeded; failures on standard
+ * output are not reported, as with std::cout.
+ * 
+ * @return true no write failed.
+ * @return false some output was lost.
+ */
+bool OutputBuffer::isGood() const{
+    return good;
+}
@@ -0,0 +1,51 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// buffered output to a file descriptor, written in large blocks.
+class OutputBuffer{
+public:
+    // constructor: fd is flushed of std::cout's pending output first.
+    OutputBuffer(int fd = 1, size_t capacity = 1 << 16);
+    // destructor: writes what is left.
+    ~OutputBuffer();
+
+    // append bytes.
+    void write(const char * data, size_t len);
+
+    // append a string.
+    void write(const std::string & str);
+
+    // append a C string.
+    void write(const char * str);
+
+    // append one character.
+    void writeChar(char c);
+
+    // append a number in decimal.
+    void writeNumber(uint64_t value);
+
+    // write everything appended so far.
+    void flush();
+
+    // check whether every write so far succeeded.
+    bool isGood() const;
+
+private:
+    OutputBuffer(const OutputBuffer &);
+    OutputBuffer & operator=(const OutputBuffer &);
+
+    int fd;
+    std::vector<char> buffer;
+    size_t used; // bytes of buffer waiting to be written
+    bool good; // no write failed
+};
+
+// append a number in decimal to a string.
+void appendNumber(std::string & out, uint64_t value);
+
+#endif
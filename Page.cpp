@@ -1,4 +1,15 @@
 #include "Page.hpp"
+#include "Output.hpp"
+#include "Stats.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /**
  * @brief print the error and exit the program.
@@ -10,6 +21,39 @@ void findError(const std::string str){
     exit(EXIT_FAILURE);
 }
 
+/**
+ * @brief Construct a new StoryError object
+ * 
+ * @param str error information.
+ */
+StoryError::StoryError(const std::string & str): std::runtime_error(str) {}
+
+/**
+ * @brief report an error in a page without exiting, so that the caller
+ * decides which error of the story is printed.
+ * 
+ * @param str error information.
+ */
+void pageError(const std::string str){
+    throw StoryError(str);
+}
+
+/**
+ * @brief report a problem of a page: throw it, or collect it when a list is
+ * given.
+ * 
+ * @param problems the list, or NULL.
+ * @param line line number, 0 for the whole file.
+ * @param str error information.
+ */
+static void pageProblem(std::vector<PageProblem> * problems, size_t line, const std::string & str){
+    if(problems == NULL){
+        pageError(str);
+    }
+    PageProblem problem = {line, str};
+    problems->push_back(problem);
+}
+
 /**
  * @brief check the argument number from command line.
  * 
@@ -32,38 +76,221 @@ void openFile(const char * name, std::ifstream &f){
     f.open(name);
 }
 
+/**
+ * @brief find the end of a line and its first colon. With SSE2, 16 bytes
+ * are compared with '\n' and ':' at once; the last bytes of the buffer, or
+ * every byte without SSE2, are scanned one by one.
+ * 
+ * @param line start of the line.
+ * @param end end of the buffer.
+ * @param colon the first ':' before the end of the line, or NULL.
+ * @return const char* the line's '\n', or end.
+ */
+static const char * scanLine(const char * line, const char * end, const char * & colon){
+    colon = NULL;
+    const char * p = line;
+#ifdef __SSE2__
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i colons = _mm_set1_epi8(':');
+    for(; end - p >= 16; p += 16){
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        unsigned newline_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines));
+        unsigned colon_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, colons));
+        if(newline_mask != 0){
+            colon_mask &= (newline_mask & -newline_mask) - 1; // colons before the newline
+        }
+        if(colon == NULL && colon_mask != 0){
+            colon = p + __builtin_ctz(colon_mask);
+        }
+        if(newline_mask != 0){
+            return p + __builtin_ctz(newline_mask);
+        }
+    }
+#endif
+    for(; p < end && *p != '\n'; ++p){
+        if(colon == NULL && *p == ':'){
+            colon = p;
+        }
+    }
+    return p;
+}
+
+/**
+ * @brief find the end of the navigation section: the end of the first line
+ * starting with '#'.
+ * 
+ * @param data the bytes read so far.
+ * @param size number of bytes.
+ * @param line_start where the first line not checked yet starts; moved to
+ * the line still incomplete.
+ * @return size_t offset after that line's '\n', or 0 if no such line is
+ * complete yet.
+ */
+static size_t findNavigationEnd(const char * data, size_t size, size_t & line_start){
+    const char * end = data + size;
+    const char * line = data + line_start;
+    while(line < end){
+        const char * eol = (const char *)memchr(line, '\n', end - line);
+        if(eol == NULL){
+            break;
+        }
+        if(line[0] == '#'){
+            return eol + 1 - data;
+        }
+        line = eol + 1;
+    }
+    line_start = line - data;
+    return 0;
+}
+
+/**
+ * @brief read a page file from the current offset into a buffer. With the
+ * text, the whole file is read at once; without it, reading stops once the
+ * navigation section is complete, a block at a time.
+ * 
+ * @param fd the open file.
+ * @param with_text read up to the end of file.
+ * @param data the bytes read.
+ * @return true the bytes reach the end of file, or the navigation section
+ * is complete.
+ * @return false the file could not be read.
+ */
+static bool readPageFile(int fd, bool with_text, std::string & data){
+    static const size_t BLOCK = 4096;
+    size_t block = BLOCK, size = 0, line_start = 0;
+    struct stat st;
+    if(with_text && fstat(fd, &st) == 0 && st.st_size > 0){
+        block = st.st_size + 1; // one read, and one more to see the end
+        data.reserve(block + BLOCK);
+    }
+    while(true){
+        data.resize(size + block);
+        ssize_t n = read(fd, &data[size], block);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        data.resize(n > 0? size + n : size);
+        if(n <= 0){
+            return n == 0;
+        }
+        STATS_ADD(STATS_BYTES_READ, n);
+        size += n;
+        if(!with_text && findNavigationEnd(data.data(), size, line_start) > 0){
+            return true;
+        }
+        block = with_text? BLOCK : block * 2;
+    }
+}
+
 // ===================================================
 
 //                  Page Class
 
 // ===================================================
+const uint64_t Page::NO_TEXT;
+
 /**
  * @brief Construct a new Page:: Page object
  * 
  */
-Page::Page() : pagination(0), choices(), text(), page_type("NOTYPE"){}
+Page::Page() : pagination(0), choices(), labels(), label_offsets(1, 0), text(), text_start(NO_TEXT), page_type(PAGE_NOTYPE){}
 
 /**
  * @brief Construct a new Page:: Page object
  * 
  * @param pn page number
  */
-Page::Page(const size_t pn) : pagination(pn), choices(), text(), page_type("NOTYPE"){}
+Page::Page(const size_t pn) : pagination(pn), choices(), labels(), label_offsets(1, 0), text(), text_start(NO_TEXT), page_type(PAGE_NOTYPE){}
 
 /**
  * @brief Construct a new Page:: Page object
  * 
  * @param file_name file name
  */
-Page::Page(const char* file_name) : pagination(0), choices(), text(), page_type("NOTYPE"){
-    std::ifstream page_file;
-    openFile(file_name, page_file);
-    if(!page_file.is_open()){
-        findError("file open unsuccessfully!");
+Page::Page(const char* file_name) : pagination(0), choices(), labels(), label_offsets(1, 0), text(), text_start(NO_TEXT), page_type(PAGE_NOTYPE){
+    try{
+        readPage(file_name);
+    }
+    catch(StoryError & e){
+        findError(e.what());
+    }
+}
+
+/**
+ * @brief read and check a page file, throwing StoryError on the first problem.
+ * 
+ * @param file_name file name
+ * @param with_text false to stop after the navigation section, only
+ * remembering where the story-text starts.
+ * @param problems NULL, or where every problem is collected instead of
+ * thrown; lines after a bad one are still checked.
+ */
+void Page::readPage(const char* file_name, bool with_text, std::vector<PageProblem> * problems){
+    int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        pageProblem(problems, 0, "file open unsuccessfully!");
+        return;
+    }
+    STATS_ADD(STATS_FILES_OPENED, 1);
+    setPageNum(file_name);
+    std::string data;
+    bool complete = readPageFile(fd, with_text, data);
+    close(fd);
+    setPage(data.data(), data.size(), complete, with_text, problems);
+}
+
+/**
+ * @brief check a page file whose first bytes were read already, as by a
+ * PageLoader. They are enough if they are the whole file, or if the
+ * navigation section is complete and the text is not needed.
+ * 
+ * @param file_name file name
+ * @param head the first bytes of the file.
+ * @param size number of bytes.
+ * @param whole the bytes are the whole file.
+ * @param with_text false to stop after the navigation section.
+ * @param problems NULL, or where every problem is collected instead of thrown.
+ * @return true the page was checked.
+ * @return false the bytes are not enough; nothing was done.
+ */
+bool Page::readPage(const char * file_name, const char * head, size_t size, bool whole, bool with_text, std::vector<PageProblem> * problems){
+    size_t line_start = 0;
+    if(!whole && (with_text || findNavigationEnd(head, size, line_start) == 0)){
+        return false;
     }
     setPageNum(file_name);
-    setPage(page_file);
-    page_file.close();
+    setPage(head, size, true, with_text, problems);
+    return true;
+}
+
+/**
+ * @brief read the story-text of a page file that was read without it.
+ * 
+ * @param file_name file name
+ * @param text_start the page's getTextStart().
+ * @param text the story-text, one '\n' after each line.
+ */
+void Page::readText(const char * file_name, uint64_t text_start, std::string & text){
+    text.clear();
+    if(text_start == NO_TEXT){
+        return;
+    }
+    int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    if(fd < 0 || lseek(fd, text_start, SEEK_SET) < 0){
+        if(fd >= 0){
+            close(fd);
+        }
+        pageError("file open unsuccessfully!");
+    }
+    STATS_ADD(STATS_FILES_OPENED, 1);
+    bool complete = readPageFile(fd, true, text);
+    close(fd);
+    if(!complete){
+        pageError("Not reach the end of file!");
+    }
+    if(!text.empty() && text[text.size() - 1] != '\n'){
+        text += '\n';
+    }
 }
 
 /**
@@ -102,124 +329,138 @@ void Page::setPageNum(std::string file_name){
 }
 
 /**
- * @brief Check whether it is a choice quesition.
+ * @brief parse the page number of a choice, as isPositiveNum checks it,
+ * without copying the string. A number too large for size_t is kept as
+ * SIZE_MAX, which no story reaches.
  * 
- * @param str the string to be checked.
- * @return true is option(has':' and the number is > 0).
- * @return false is not a option.
+ * @param str the digits.
+ * @param len number of digits.
+ * @return size_t the page number; 0 if the string is empty, has anything
+ * but digits, or is 0.
  */
-bool Page::isOption(const std::string str){
-    size_t find_colon = str.find(':');
-    if(find_colon == str.npos){
-        findError("This choice has no colon, illegal format!");
-    }
-
-    std::string pagination = str.substr(0, find_colon);
-    if(isPositiveNum(pagination) == 0){
-        findError("This choice has illegal page number!");
+size_t Page::parsePageNum(const char * str, size_t len){
+    size_t number = 0;
+    bool overflow = false;
+    for(size_t i = 0; i < len; ++i){
+        unsigned digit = (unsigned char)str[i] - '0';
+        if(digit > 9){
+            return 0;
+        }
+        if(number > (SIZE_MAX - digit) / 10){
+            overflow = true;
+        }
+        number = number * 10 + digit;
     }
-
-    return true;
+    return overflow? SIZE_MAX : number;
 }
 
 /**
- * @brief Extract the number of pages referenced by each choice question.
+ * @brief check a choice line, then extract the page it leads to and its
+ * description. The page becomes a choice page first, so a choice on a WIN
+ * or LOSE page is rejected without being kept.
  * 
- * @param str the choice
+ * @param line the line, without its '\n'.
+ * @param len length of the line.
+ * @param colon the first ':' of the line, or NULL.
  */
-void Page::addChoice(std::string str){
-    if(isOption(str)){
-        size_t colon = str.find(':');
-        size_t pn = atoi(str.substr(0, colon).c_str());
-        std::string choice_text = str.substr(colon + 1);
-        choices.push_back(std::pair<std::string, size_t>(choice_text, pn));
+void Page::addChoice(const char * line, size_t len, const char * colon){
+    if(colon == NULL){
+        pageError("This choice has no colon, illegal format!");
     }
+    size_t pn = parsePageNum(line, colon - line);
+    if(pn == 0){
+        pageError("This choice has illegal page number!");
+    }
+    setPageType(PAGE_CHOICE);
+    choices.push_back(pn);
+    labels.append(colon + 1, line + len - colon - 1);
+    label_offsets.push_back(labels.size());
 }
 
 /**
  * @brief set the page's type: CHOICE, WIN, LOSE
  * 
- * @param str the type
+ * @param type the type
  */
-void Page::setPageType(const std::string str){
-    if(page_type == "NOTYPE"){
-        page_type = str;
+void Page::setPageType(PageType type){
+    if(page_type == PAGE_NOTYPE){
+        page_type = type;
     }
-    else if(page_type != str){
-        findError("It's a mix type page, illegal!");
+    else if(page_type != type){
+        pageError("It's a mix type page, illegal!");
     }
 }
 
 /**
- * @brief set the page's story-text (after'#').
+ * @brief the handler to store the info in a page. Each line is found with
+ * its first colon in one scan; the story-text is taken as it is.
  * 
- * @param str line in the story text.
+ * @param data the page file's bytes, from its start.
+ * @param size number of bytes.
+ * @param complete the bytes reach the end of file.
+ * @param with_text false to stop at the '#', only remembering where the
+ * story-text starts.
+ * @param problems NULL, or where every problem is collected instead of
+ * thrown.
  */
-void Page::setText(const std::string str){
-    text.push_back(str);
-}
+void Page::setPage(const char * data, size_t size, bool complete, bool with_text, std::vector<PageProblem> * problems){
+    const char * end = data + size;
+    size_t line_num = 0;
+    for(const char * line = data; line < end; ){
+        const char * colon;
+        const char * eol = scanLine(line, end, colon);
+        const char * next = eol < end? eol + 1 : end;
+        size_t len = eol - line;
+        ++line_num;
 
-/**
- * @brief the handler to store the info in a page.
- * 
- * @param page the page information
- */
-void Page::setPage(std::istream &page){
-    int pound_sign = 0; // judge the stream is before or behind the '#'
-    int empty_file = 1; // check whether it is an empty file
-
-    std::string line;
-    while(getline(page, line)){
-        empty_file = 0;
-
-        if(pound_sign == 0){ // stream still before '#'
-            if(line == "WIN"){
-                if(page_type == "WIN"){
-                    findError("The navigation section of the WIN page has redundant content!");
+        if(len > 0 && line[0] == '#'){ // the story-text follows
+            if(!with_text){
+                text_start = eol < end? next - data : NO_TEXT;
+                return;
+            }
+            text.assign(next, end - next);
+            if(!text.empty() && text[text.size() - 1] != '\n'){
+                text += '\n';
+            }
+            break;
+        }
+        try{
+            if(len == 3 && memcmp(line, "WIN", 3) == 0){
+                if(page_type == PAGE_WIN){
+                    pageError("The navigation section of the WIN page has redundant content!");
                 }
-                setPageType(line); // set type as "WIN"
+                setPageType(PAGE_WIN);
             }
-            else if(line == "LOSE"){
-                if(page_type == "LOSE"){
-                    findError("The navigation section of the LOSE page has redundant content!");
+            else if(len == 4 && memcmp(line, "LOSE", 4) == 0){
+                if(page_type == PAGE_LOSE){
+                    pageError("The navigation section of the LOSE page has redundant content!");
                 }
-                setPageType(line); // set type as "LOSE"
+                setPageType(PAGE_LOSE);
             }
             else{
-                if(line[0] == '#'){
-                    pound_sign = 1;
-                    continue;
-                }
-                addChoice(line);
-                if(choices.size() == 1){
-                    setPageType("CHOICE"); // set type as "CHOICE"
-                }
+                addChoice(line, len, colon);
             }
         }
-        else{ // content behind the '#'
-            setText(line);
+        catch(StoryError & e){ // a bad line; the next lines are checked on their own
+            pageProblem(problems, line_num, e.what());
         }
+        line = next;
     }
-    if(!page.eof()){
-        findError("Not reach the end of file!");
+    if(!complete){
+        pageProblem(problems, 0, "Not reach the end of file!");
     }
-    if(empty_file == 1){ // if it's an empty file.
-        findError("It's an empty page, illegal input!");
+    if(size == 0){ // if it's an empty file.
+        pageProblem(problems, 0, "It's an empty page, illegal input!");
     }
 }
 
 /**
  * @brief get the optional page numbers
  * 
- * @return std::vector<size_t> optional page number in container.
+ * @return const std::vector<size_t>& optional page number in container.
  */
-std::vector<size_t> Page::getChoices(){
-    std:: vector<size_t> res;
-    std:: vector<std::pair<std::string, size_t> > :: iterator it;
-    for(it = choices.begin(); it != choices.end(); ++it){
-        res.push_back(it->second);
-    }
-    return res;
+const std::vector<size_t> & Page::getChoices(){
+    return choices;
 }
 
 /**
@@ -234,42 +475,103 @@ size_t Page::getPageNum(){
 /**
  * @brief get the page type.
  * 
- * @return std::string "CHOICE","WIN","LOSE"
+ * @return PageType PAGE_CHOICE, PAGE_WIN, PAGE_LOSE
  */
-std::string Page::getType(){
+PageType Page::getType(){
     return page_type;
 }
 
 /**
- * @brief print the page's info.
+ * @brief get the choice descriptions, back to back.
+ * 
+ * @return const std::string& the descriptions, split by getLabelOffsets().
+ */
+const std::string & Page::getLabels(){
+    return labels;
+}
+
+/**
+ * @brief get the offset of each choice description in getLabels().
+ * 
+ * @return const std::vector<uint64_t>& one offset per choice, plus the end.
+ */
+const std::vector<uint64_t> & Page::getLabelOffsets(){
+    return label_offsets;
+}
+
+/**
+ * @brief get the story-text.
+ * 
+ * @return const std::string& lines behind the '#', each followed by '\n'.
+ */
+const std::string & Page::getText(){
+    return text;
+}
+
+/**
+ * @brief get the file offset of the story-text, when the page was read
+ * without it.
+ * 
+ * @return uint64_t offset of the line after the '#', or NO_TEXT.
+ */
+uint64_t Page::getTextStart(){
+    return text_start;
+}
+
+/**
+ * @brief print the page's info, in one write.
  * 
  */
 void Page::printPage(){
-    // 1. print the text of the page
-    for(size_t i = 0; i < text.size(); i++){
-        std::cout << text[i] << std::endl;
+    std::string rendered;
+    renderPage(page_type, text.data(), text.size(), labels.data(), label_offsets.data(), choices.size(), rendered);
+    OutputBuffer out;
+    out.write(rendered);
+}
+
+/**
+ * @brief render a page as printed: its text, then its choices or its WIN/LOSE
+ * message.
+ * 
+ * @param type the page type.
+ * @param text the story-text, one '\n' after each line.
+ * @param text_len length of the story-text.
+ * @param labels the choice descriptions, back to back.
+ * @param label_offsets offset of each description in labels, plus the end.
+ * @param choice_num number of choices.
+ * @param out the rendered page is appended here.
+ */
+void renderPage(PageType type, const char * text, size_t text_len, const char * labels,
+                const uint64_t * label_offsets, size_t choice_num, std::string & out){
+    size_t size = text_len + 64;
+    if(choice_num > 0){
+        size += label_offsets[choice_num] - label_offsets[0] + choice_num * 24;
     }
+    out.reserve(out.size() + size);
+
+    // 1. print the text of the page
+    out.append(text, text_len);
 
     // 2. Next, print a blank line.
-    std::cout << std::endl;
-    if(page_type == "CHOICE"){
+    out += '\n';
+    if(type == PAGE_CHOICE){
         // 3. Then print What would you like to do?
-        std::cout << "What would you like to do?" << std::endl;
-
         // 4. Then print another blank line.
-        std::cout << std::endl;
+        out += "What would you like to do?\n\n";
 
         // 5. Then print each possible choice, one per line.
-        std:: vector<std::pair<std::string, size_t> >:: iterator it;
-        int choice_num = 1;
-        for(it = choices.begin(); it != choices.end(); ++it){
-            std::cout << " " << choice_num++ << ". " << it->first << std::endl;
+        for(size_t i = 0; i < choice_num; ++i){
+            out += ' ';
+            appendNumber(out, i + 1);
+            out += ". ";
+            out.append(labels + label_offsets[i], label_offsets[i + 1] - label_offsets[i]);
+            out += '\n';
         }
     }
-    else if(page_type == "WIN"){
-        std::cout<< "Congratulations! You have won. Hooray!" << std::endl;
+    else if(type == PAGE_WIN){
+        out += "Congratulations! You have won. Hooray!\n";
     }
-    else if(page_type == "LOSE"){
-        std::cout<< "Sorry, you have lost. Better luck next time!" << std::endl;
+    else if(type == PAGE_LOSE){
+        out += "Sorry, you have lost. Better luck next time!\n";
     }
 }
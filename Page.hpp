@@ -1,3 +1,6 @@
+#ifndef PAGE_HPP
+#define PAGE_HPP
+
 #include <iostream>
 #include <cstdlib>
 #include <cstdio>
@@ -9,7 +12,23 @@
 #include <string>
 #include <queue>
 #include <stack>
+#include <stdexcept>
+#include <stdint.h>
+
+// page types; the values are stored in compiled stories.
+enum PageType{
+    PAGE_CHOICE = 0,
+    PAGE_WIN = 1,
+    PAGE_LOSE = 2,
+    PAGE_NOTYPE = 3
+};
 
+// one problem of a page file: the line it is on (0 for the whole file) and
+// the error the page would be rejected with.
+struct PageProblem{
+    size_t line;
+    std::string error;
+};
 
 // single page
 class Page{
@@ -22,51 +41,92 @@ public:
     // destructor
     ~Page(){}
 
+    // read and check a page file, throwing StoryError on the first problem,
+    // or with problems given, collecting every problem there instead.
+    void readPage(const char * file_name, bool with_text = true, std::vector<PageProblem> * problems = NULL);
+
+    // check a page file from its first bytes, read already; whole if they are the
+    // whole file. false, with nothing done, if they are not enough.
+    bool readPage(const char * file_name, const char * head, size_t size, bool whole, bool with_text = true, std::vector<PageProblem> * problems = NULL);
+
+    // read the story-text of a page file from where getTextStart() points.
+    static void readText(const char * file_name, uint64_t text_start, std::string & text);
+
     // If the string is positive, the positive number is returned, otherwise 0 is returned.
-    int isPositiveNum(std::string content);
+    static int isPositiveNum(std::string content);
+
+    // parse the page number of a choice: 0 unless all digits and positive, SIZE_MAX if too large.
+    static size_t parsePageNum(const char * str, size_t len);
 
     // Gets the page number from the file name.
     void setPageNum(std::string file_name);
 
-    // Check whether it is a choice quesition.
-    bool isOption(const std::string str);
-
-    // Extract the number of pages referenced by each choice question.
-    void addChoice(std::string str);
+    // check and add a choice line, making the page a choice page; colon is its first ':', or NULL.
+    void addChoice(const char * line, size_t len, const char * colon);
 
     // set the page's type: CHOICE, WIN, LOSE
-    void setPageType(const std::string str);
+    void setPageType(PageType type);
 
-    // set the page's story-text (after'#').
-    void setText(const std::string str);
-
-    // the handler to store the info in a page.
-    void setPage(std::istream &page);
+    // the handler to store the info in a page, from the file's bytes; complete if they reach the end of file.
+    void setPage(const char * data, size_t size, bool complete, bool with_text = true, std::vector<PageProblem> * problems = NULL);
 
     // get the optional page numbers
-    std::vector<size_t> getChoices();
+    const std::vector<size_t> & getChoices();
 
     // get the page number.
     size_t getPageNum();
 
     // get the page type.
-    std::string getType();
+    PageType getType();
+
+    // get the choice descriptions, back to back.
+    const std::string & getLabels();
+
+    // get the offset of each choice description in getLabels(), plus the end.
+    const std::vector<uint64_t> & getLabelOffsets();
+
+    // get the story-text, one '\n' after each line.
+    const std::string & getText();
+
+    // get the file offset of the story-text, when it was not read.
+    uint64_t getTextStart();
+
+    // text start of a page without story-text.
+    static const uint64_t NO_TEXT = UINT64_MAX;
     
     // print the page's info.
     void printPage();
 
 private:
     size_t pagination; // page number
-    std::vector<std::pair<std::string, size_t> > choices; // optional page numbers
-    std::vector<std::string> text; // story behind the '#'
-    std::string page_type; // "CHOICE"/"WIN"/"LOSE"
+    std::vector<size_t> choices; // optional page numbers
+    std::string labels; // choice descriptions
+    std::vector<uint64_t> label_offsets; // where each choice description starts in labels, plus the end
+    std::string text; // story behind the '#'
+    uint64_t text_start; // file offset of the story behind the '#', when it was not read
+    PageType page_type; // PAGE_CHOICE/PAGE_WIN/PAGE_LOSE, PAGE_NOTYPE until known
+};
+
+// render a page as printed: its text, then its choices or its WIN/LOSE message.
+void renderPage(PageType type, const char * text, size_t text_len, const char * labels,
+                const uint64_t * label_offsets, size_t choice_num, std::string & out);
+
+// an error in the story format, not yet reported to the user.
+class StoryError : public std::runtime_error{
+public:
+    explicit StoryError(const std::string & str);
 };
 
 // print the error and exit the program.
 void findError(const std::string str);
 
+// throw the error as a StoryError instead of exiting.
+void pageError(const std::string str);
+
 // check the argument number from command line.
 void argumentCheck(int argc, int want_argc);
 
 // open the file.
 void openFile(const char * name, std::ifstream &f);
+
+#endif
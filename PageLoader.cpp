@@ -0,0 +1,368 @@
+#include "PageLoader.hpp"
+#include "Page.hpp"
+#include "Parallel.hpp"
+#include "Stats.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// io_uring entries: opens or reads in flight at once.
+static const unsigned RING_DEPTH = 256;
+
+// threads opening and reading files when there is no io_uring and no number
+// is given. Most of their time is spent waiting for the disk, so there are
+// more than cores.
+static const size_t POOL_THREADS = 16;
+
+static std::atomic<int> default_io(PAGE_IO_AUTO);
+
+// the io_uring instance: its file descriptor, and the submission and
+// completion rings shared with the kernel.
+struct PageLoader::Ring{
+    int fd;
+    void * sq_map;
+    size_t sq_size;
+    void * cq_map;
+    size_t cq_size;
+    io_uring_sqe * sqes;
+    size_t sqes_size;
+    unsigned * sq_tail;
+    unsigned sq_mask;
+    unsigned * sq_array;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe * cqes;
+};
+
+/**
+ * @brief Construct a new PageLoader::PageLoader object
+ * 
+ * @param block bytes read per file.
+ * @param batch files per batch.
+ * @param io the way to read files; PAGE_IO_AUTO falls back to pread
+ * without io_uring, and so does PAGE_IO_URING.
+ * @param thread_num threads reading files with pread; 0 for POOL_THREADS.
+ */
+PageLoader::PageLoader(size_t block, size_t batch, PageIo io, size_t thread_num) : block(block), batch(batch), io(PAGE_IO_PREAD), thread_num(thread_num > 0? thread_num : POOL_THREADS), ring(NULL), arena(block * batch), sizes(batch, -1), fds(batch, -1){
+    if(io != PAGE_IO_PREAD && setupRing()){
+        this->io = PAGE_IO_URING;
+    }
+}
+
+/**
+ * @brief Destroy the PageLoader::PageLoader object
+ * 
+ */
+PageLoader::~PageLoader(){
+    if(ring != NULL){
+        munmap(ring->sqes, ring->sqes_size);
+        if(ring->cq_map != ring->sq_map){
+            munmap(ring->cq_map, ring->cq_size);
+        }
+        munmap(ring->sq_map, ring->sq_size);
+        close(ring->fd);
+        delete ring;
+    }
+}
+
+/**
+ * @brief set up an io_uring instance and map its rings. The kernel may
+ * not have io_uring, or may forbid it.
+ * 
+ * @return true io_uring is ready.
+ * @return false it is not; nothing is left open.
+ */
+bool PageLoader::setupRing(){
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, RING_DEPTH, &params);
+    if(fd < 0){
+        return false;
+    }
+    Ring * r = new Ring;
+    r->fd = fd;
+    r->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    r->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single && r->cq_size > r->sq_size){
+        r->sq_size = r->cq_size;
+    }
+    r->sq_map = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    r->cq_map = r->sq_map;
+    if(r->sq_map != MAP_FAILED && !single){
+        r->cq_map = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    r->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    r->sqes = (io_uring_sqe *)MAP_FAILED;
+    if(r->sq_map != MAP_FAILED && r->cq_map != MAP_FAILED){
+        r->sqes = (io_uring_sqe *)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    }
+    if(r->sqes == MAP_FAILED){
+        if(r->cq_map != MAP_FAILED && r->cq_map != r->sq_map){
+            munmap(r->cq_map, r->cq_size);
+        }
+        if(r->sq_map != MAP_FAILED){
+            munmap(r->sq_map, r->sq_size);
+        }
+        close(fd);
+        delete r;
+        return false;
+    }
+    char * sq = (char *)r->sq_map;
+    char * cq = (char *)r->cq_map;
+    r->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    r->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + params.sq_off.array);
+    r->cq_head = (unsigned *)(cq + params.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    r->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    r->cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring = r;
+    return true;
+}
+
+/**
+ * @brief read the start of a batch of page files: up to block bytes of
+ * each, at offset 0, into the arena.
+ * 
+ * @param files file names.
+ * @param n number of files, at most batch.
+ */
+void PageLoader::read(const std::string * files, size_t n){
+    if(ring != NULL){
+        readRing(files, n);
+    }
+    else{
+        readPool(files, n);
+    }
+}
+
+/**
+ * @brief read a batch through io_uring in two rounds: every file is opened,
+ * then every opened file is read, RING_DEPTH requests in flight at a time.
+ * The kernel works on the requests of a round in parallel, so a cold cache
+ * costs about one disk wait per round instead of two per file. Opens the
+ * kernel doesn't support as requests are done here instead. A read that
+ * stops short is queued again from where it stopped, until block bytes or
+ * the end of file, as the pread pool does.
+ * 
+ * @param files file names.
+ * @param n number of files, at most batch.
+ */
+void PageLoader::readRing(const std::string * files, size_t n){
+    for(int round = 0; round < 2; ++round){
+        size_t next = 0, in_flight = 0, unsubmitted = 0;
+        std::vector<size_t> again; // files whose read stopped short
+        while(next < n || in_flight > 0 || !again.empty()){
+            // queue requests while there is room.
+            unsigned tail = *ring->sq_tail;
+            unsigned queued = 0;
+            while((next < n || !again.empty()) && in_flight + queued < RING_DEPTH){
+                size_t i;
+                if(!again.empty()){
+                    i = again.back();
+                    again.pop_back();
+                }
+                else{
+                    i = next++;
+                    if(round == 1 && fds[i] < 0){
+                        continue;
+                    }
+                    sizes[i] = 0;
+                }
+                unsigned index = (tail + queued) & ring->sq_mask;
+                io_uring_sqe * sqe = &ring->sqes[index];
+                memset(sqe, 0, sizeof(*sqe));
+                if(round == 0){
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = (uintptr_t)files[i].c_str();
+                    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                }
+                else{
+                    sqe->opcode = IORING_OP_READ;
+                    sqe->fd = fds[i];
+                    sqe->addr = (uintptr_t)&arena[i * block + sizes[i]];
+                    sqe->len = block - sizes[i];
+                    sqe->off = sizes[i];
+                }
+                sqe->user_data = i;
+                ring->sq_array[index] = index;
+                ++queued;
+            }
+            __atomic_store_n(ring->sq_tail, tail + queued, __ATOMIC_RELEASE);
+            in_flight += queued;
+            unsubmitted += queued;
+            if(in_flight == 0){
+                break;
+            }
+
+            // submit them and wait for at least one to complete.
+            int ret = syscall(__NR_io_uring_enter, ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if(ret >= 0){
+                unsubmitted -= ret;
+            }
+            else if(errno != EINTR && errno != EAGAIN && errno != EBUSY){
+                findError("io_uring_enter failed!");
+            }
+            unsigned head = *ring->cq_head;
+            unsigned end = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+            for(; head != end; ++head){
+                const io_uring_cqe & cqe = ring->cqes[head & ring->cq_mask];
+                size_t i = cqe.user_data;
+                if(round == 0 && cqe.res == -EINVAL){
+                    fds[i] = open(files[i].c_str(), O_RDONLY | O_CLOEXEC);
+                }
+                else if(round == 0){
+                    fds[i] = cqe.res;
+                }
+                else if(cqe.res == -EINTR || cqe.res == -EAGAIN){
+                    again.push_back(i);
+                }
+                else if(cqe.res < 0){
+                    sizes[i] = -1;
+                }
+                else{
+                    sizes[i] += cqe.res;
+                    if(cqe.res > 0 && (size_t)sizes[i] < block){
+                        again.push_back(i);
+                    }
+                }
+                --in_flight;
+            }
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    for(size_t i = 0; i < n; ++i){
+        if(fds[i] >= 0){
+            STATS_ADD(STATS_FILES_OPENED, 1);
+            if(sizes[i] > 0){
+                STATS_ADD(STATS_BYTES_READ, sizes[i]);
+            }
+            close(fds[i]);
+            fds[i] = -1;
+        }
+        else{
+            sizes[i] = -1;
+        }
+    }
+}
+
+/**
+ * @brief read a batch with open and pread, thread_num files at a time.
+ * 
+ * @param files file names.
+ * @param n number of files, at most batch.
+ */
+void PageLoader::readPool(const std::string * files, size_t n){
+    parallelFor(n, thread_num, [&](size_t i){
+        sizes[i] = -1;
+        int fd = open(files[i].c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0){
+            return;
+        }
+        STATS_ADD(STATS_FILES_OPENED, 1);
+        size_t size = 0;
+        while(size < block){
+            ssize_t got = pread(fd, &arena[i * block + size], block - size, size);
+            if(got < 0 && errno == EINTR){
+                continue;
+            }
+            if(got < 0){
+                close(fd);
+                return;
+            }
+            if(got == 0){
+                break;
+            }
+            STATS_ADD(STATS_BYTES_READ, got);
+            size += got;
+        }
+        close(fd);
+        sizes[i] = size;
+    });
+}
+
+/**
+ * @brief get the bytes read of a file of the last batch.
+ * 
+ * @param i index of the file in the batch.
+ * @return const char* its first getSize(i) bytes.
+ */
+const char * PageLoader::getData(size_t i) const{
+    return &arena[i * block];
+}
+
+/**
+ * @brief get the number of bytes read of a file of the last batch.
+ * 
+ * @param i index of the file in the batch.
+ * @return ssize_t the number of bytes, or -1 if it could not be opened or read.
+ */
+ssize_t PageLoader::getSize(size_t i) const{
+    return sizes[i];
+}
+
+/**
+ * @brief check whether the bytes read of a file are the whole file: both
+ * ways of reading go on until block bytes or a read at the end of file.
+ * 
+ * @param i index of the file in the batch.
+ * @return true fewer than block bytes were read.
+ * @return false the file may be longer.
+ */
+bool PageLoader::isWhole(size_t i) const{
+    return sizes[i] >= 0 && (size_t)sizes[i] < block;
+}
+
+/**
+ * @brief get the way this loader reads files.
+ * 
+ * @return PageIo PAGE_IO_URING or PAGE_IO_PREAD.
+ */
+PageIo PageLoader::getIo() const{
+    return io;
+}
+
+/**
+ * @brief set the way loaders read files by default, as for benchmarks.
+ * 
+ * @param io the way to read files.
+ */
+void PageLoader::setDefaultIo(PageIo io){
+    default_io.store(io);
+}
+
+/**
+ * @brief get the way loaders read files by default.
+ * 
+ * @return PageIo PAGE_IO_AUTO unless setDefaultIo was called.
+ */
+PageIo PageLoader::getDefaultIo(){
+    return (PageIo)default_io.load();
+}
+
+/**
+ * @brief get the name of a way to read files.
+ * 
+ * @param io the way to read files.
+ * @return const char* "auto", "uring" or "pread".
+ */
+const char * PageLoader::getIoName(PageIo io){
+    switch(io){
+        case PAGE_IO_URING:
+            return "uring";
+        case PAGE_IO_PREAD:
+            return "pread";
+        default:
+            return "auto";
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef PAGE_LOADER_HPP
+#define PAGE_LOADER_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// how a PageLoader reads files.
+enum PageIo{
+    PAGE_IO_AUTO, // io_uring if the kernel has it, else pread
+    PAGE_IO_URING,
+    PAGE_IO_PREAD
+};
+
+// reads the first bytes of a batch of page files at once, into one arena
+// allocated up front: opens and reads are queued together on io_uring, or
+// run by a pool of threads with open and pread when io_uring is missing.
+class PageLoader{
+public:
+    // constructor: up to block bytes of up to batch files at a time; without
+    // io_uring, on thread_num threads, or a default number for 0.
+    PageLoader(size_t block, size_t batch, PageIo io = PAGE_IO_AUTO, size_t thread_num = 0);
+    // destructor
+    ~PageLoader();
+
+    // read the start of files[0] ... files[n - 1], n at most batch.
+    void read(const std::string * files, size_t n);
+
+    // get the bytes read of file i of the last batch.
+    const char * getData(size_t i) const;
+
+    // get the number of bytes read of file i, or -1 if it could not be opened or read.
+    ssize_t getSize(size_t i) const;
+
+    // check whether the bytes read of file i are the whole file.
+    bool isWhole(size_t i) const;
+
+    // get the way files are read: PAGE_IO_URING or PAGE_IO_PREAD.
+    PageIo getIo() const;
+
+    // set the way loaders read files by default.
+    static void setDefaultIo(PageIo io);
+
+    // get the way loaders read files by default.
+    static PageIo getDefaultIo();
+
+    // get the name of a way to read files.
+    static const char * getIoName(PageIo io);
+
+private:
+    PageLoader(const PageLoader &);
+    PageLoader & operator=(const PageLoader &);
+
+    // the io_uring instance and its mapped rings.
+    struct Ring;
+
+    // set up io_uring; false if the kernel refuses.
+    bool setupRing();
+
+    // read the batch through io_uring.
+    void readRing(const std::string * files, size_t n);
+
+    // read the batch with open and pread on a pool of threads.
+    void readPool(const std::string * files, size_t n);
+
+    size_t block; // bytes read per file
+    size_t batch; // files per batch
+    PageIo io;
+    size_t thread_num; // threads of the pread pool
+    Ring * ring; // NULL unless io is PAGE_IO_URING
+    std::vector<char> arena; // block bytes per file of the batch
+    std::vector<ssize_t> sizes; // bytes read per file, -1 on failure
+    std::vector<int> fds; // files opened in the batch
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief get the default number of worker threads: one per hardware thread.
+ * 
+ * @return size_t at least 1.
+ */
+size_t defaultThreads(){
+    size_t n = std::thread::hardware_concurrency();
+    return n > 0? n : 1;
+}
+
+/**
+ * @brief run task(0) ... task(n - 1) on up to thread_num threads. The calling
+ * thread is one of the workers, so thread_num == 1 runs the items in order
+ * without starting any thread.
+ * 
+ * @param n number of items.
+ * @param thread_num maximum number of threads.
+ * @param task the work for one item; it must not throw.
+ */
+void parallelFor(size_t n, size_t thread_num, const std::function<void(size_t)> & task){
+    if(thread_num > n){
+        thread_num = n;
+    }
+    if(thread_num <= 1){
+        for(size_t i = 0; i < n; ++i){
+            task(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::function<void()> worker = [&](){
+        size_t i;
+        while((i = next.fetch_add(1)) < n){
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(size_t t = 1; t < thread_num; ++t){
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < threads.size(); ++t){
+        threads[t].join();
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+// get the default number of worker threads: one per hardware thread.
+size_t defaultThreads();
+
+// run task(0) ... task(n - 1) on up to thread_num threads. Items are handed
+// out in index order, so item i starts no later than any item j > i.
+void parallelFor(size_t n, size_t thread_num, const std::function<void(size_t)> & task);
+
+#endif
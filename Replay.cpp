@@ -0,0 +1,139 @@
+#include "Replay.hpp"
+#include "Parallel.hpp"
+#include "Stats.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief get the file name of a path, without its directories.
+ * 
+ * @param path a file path.
+ * @return std::string what follows the last '/'.
+ */
+static std::string baseName(const std::string & path){
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos? path : path.substr(slash + 1);
+}
+
+/**
+ * @brief list input scripts. A directory gives its regular files, except
+ * hidden ones, in name order; any other file is a manifest naming one script
+ * per line, in replay order. Empty manifest lines are skipped.
+ * 
+ * @param path a script directory or a manifest.
+ * @return std::vector<std::string> the script paths.
+ */
+std::vector<std::string> listScripts(const std::string & path){
+    std::vector<std::string> scripts;
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0){
+        findError("file open unsuccessfully!");
+    }
+    if(S_ISDIR(st.st_mode)){
+        DIR * d = opendir(path.c_str());
+        if(d == NULL){
+            findError("file open unsuccessfully!");
+        }
+        struct dirent * entry;
+        while((entry = readdir(d)) != NULL){
+            std::string file = path + "/" + entry->d_name;
+            if(entry->d_name[0] != '.' && stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode)){
+                scripts.push_back(file);
+            }
+        }
+        closedir(d);
+        std::sort(scripts.begin(), scripts.end());
+        return scripts;
+    }
+
+    std::ifstream manifest(path.c_str());
+    if(!manifest.is_open()){
+        findError("file open unsuccessfully!");
+    }
+    std::string line;
+    while(getline(manifest, line)){
+        if(!line.empty()){
+            scripts.push_back(line);
+        }
+    }
+    return scripts;
+}
+
+/**
+ * @brief replay one script, as cyoa-step2 would with the script as input.
+ * 
+ * @param story the story.
+ * @param script the script path.
+ * @param output the transcript path.
+ */
+static void replayScript(const Story & story, const std::string & script, const std::string & output){
+    std::ifstream input(script.c_str());
+    if(!input.is_open()){
+        pageError("file open unsuccessfully!");
+    }
+    int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0){
+        pageError("The transcript cannot be written!");
+    }
+    bool good;
+    {
+        OutputBuffer out(fd);
+        ReaderSession session(story);
+        session.play(input, out, false);
+        out.flush();
+        good = out.isGood();
+    }
+    if(close(fd) != 0 || !good){
+        pageError("The transcript cannot be written!");
+    }
+}
+
+/**
+ * @brief replay each script as a reader of the story, the scripts shared out
+ * between up to thread_num threads. A transcript is byte-identical to the
+ * output of cyoa-step2 for that script. When scripts fail, the error of the
+ * first failing one in list order is reported.
+ * 
+ * @param story the story.
+ * @param scripts the script paths.
+ * @param output_dir the directory receiving the transcripts; created if missing.
+ * @param thread_num number of threads.
+ */
+void replayScripts(const Story & story, const std::vector<std::string> & scripts, const std::string & output_dir,
+                   size_t thread_num){
+    std::vector<std::string> outputs(scripts.size());
+    std::set<std::string> names;
+    for(size_t i = 0; i < scripts.size(); ++i){
+        std::string name = baseName(scripts[i]);
+        if(!names.insert(name).second){
+            findError("Two scripts have the same name!");
+        }
+        outputs[i] = output_dir + "/" + name + ".out";
+    }
+    if(mkdir(output_dir.c_str(), 0755) != 0 && errno != EEXIST){
+        findError("The output directory cannot be created!");
+    }
+
+    STATS_PHASE(STATS_REPLAY);
+    std::vector<std::string> errors(scripts.size());
+    std::atomic<size_t> first_error(scripts.size()); // lowest failed script index so far
+    parallelFor(scripts.size(), thread_num, [&](size_t i){
+        try{
+            replayScript(story, scripts[i], outputs[i]);
+        }
+        catch(StoryError & e){
+            errors[i] = scripts[i] + ": " + e.what();
+            size_t seen = first_error.load();
+            while(i < seen && !first_error.compare_exchange_weak(seen, i)){}
+        }
+    });
+    if(first_error.load() < scripts.size()){
+        findError(errors[first_error.load()]);
+    }
+}
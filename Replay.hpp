@@ -0,0 +1,16 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <string>
+#include <vector>
+#include "CYOA.hpp"
+
+// list input scripts: the files of a directory, or the lines of a manifest.
+std::vector<std::string> listScripts(const std::string & path);
+
+// replay each script as a reader of the story on up to thread_num threads,
+// writing each transcript to <output dir>/<script name>.out.
+void replayScripts(const Story & story, const std::vector<std::string> & scripts, const std::string & output_dir,
+                   size_t thread_num);
+
+#endif
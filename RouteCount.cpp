@@ -0,0 +1,145 @@
+#include "RouteCount.hpp"
+#include "Stats.hpp"
+
+/**
+ * @brief Construct a new RouteCounter object
+ * 
+ * @param graph the story graph.
+ * @param is_win whether each page is a WIN page, indexed by page number.
+ */
+RouteCounter::RouteCounter(const StoryGraph & graph, const std::vector<bool> & is_win): graph(graph), is_win(is_win), component(), win_from(), arrive(), through(), on_path() {}
+
+/**
+ * @brief count the routes from page 1 and through each page. Components are
+ * visited twice: in reverse topological order to know how many ways to WIN
+ * each entry page has, then in topological order to push the number of ways
+ * to arrive at each entry forward and credit every page on the way.
+ * 
+ */
+void RouteCounter::count(){
+    size_t page_num = graph.getPageNum();
+    size_t component_num = graph.findComponents(component);
+    win_from.assign(page_num + 1, BigCount());
+    arrive.assign(page_num + 1, BigCount());
+    through.assign(page_num + 1, BigCount());
+    on_path.assign(page_num + 1, false);
+
+    // pages of each component, components in completion order.
+    std::vector<uint32_t> first(component_num + 2, 0), members(page_num);
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        ++first[component[pn] + 1];
+    }
+    for(size_t c = 1; c < first.size(); ++c){
+        first[c] += first[c - 1];
+    }
+    std::vector<uint32_t> fill(first);
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        members[fill[component[pn]]++] = pn;
+    }
+
+    // entries: page 1 and pages chosen from another component.
+    std::vector<bool> is_entry(page_num + 1, false);
+    is_entry[1] = true;
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        Span<uint32_t> refs = graph.getReferences(pn);
+        for(size_t i = 0; i < refs.size() && !is_entry[pn]; ++i){
+            is_entry[pn] = component[refs[i]] != 0 && component[refs[i]] != component[pn];
+        }
+    }
+
+    for(size_t c = 1; c <= component_num; ++c){
+        for(uint32_t i = first[c]; i < first[c + 1]; ++i){
+            if(is_entry[members[i]]){
+                win_from[members[i]] = countEntry(members[i], NULL);
+            }
+        }
+    }
+    arrive[1] = BigCount(1);
+    for(size_t c = component_num; c >= 1; --c){
+        for(uint32_t i = first[c]; i < first[c + 1]; ++i){
+            if(!arrive[members[i]].isZero()){
+                BigCount arrivals = arrive[members[i]];
+                countEntry(members[i], &arrivals);
+            }
+        }
+    }
+}
+
+/**
+ * @brief enumerate the paths inside the entry's component that start at the
+ * entry, adding the ways to WIN from the pages choices lead to outside it.
+ * With arrivals, each path is also taken that many times: pages on it are
+ * credited with the routes through them and the pages it leaves the
+ * component for gain arrivals.
+ * 
+ * @param entry the first page of the component on the path.
+ * @param arrivals the number of routes from page 1 arriving at the entry, or NULL.
+ * @return BigCount the number of routes from the entry to WIN.
+ */
+BigCount RouteCounter::countEntry(uint32_t entry, const BigCount * arrivals){
+    struct Frame{
+        uint32_t page; // page num
+        uint32_t next; // next choice to follow
+        BigCount wins; // routes to WIN found below this page so far
+    };
+    std::vector<Frame> frames;
+    BigCount result;
+
+    Frame root = {entry, 0, BigCount(is_win[entry]? 1 : 0)};
+    frames.push_back(root);
+    STATS_ADD(STATS_DFS_PUSHED, 1);
+    on_path[entry] = true;
+    while(!frames.empty()){
+        Frame & top = frames.back();
+        Span<uint32_t> options = graph.getChoices(top.page);
+        if(top.next < options.size()){
+            uint32_t next = options[top.next++];
+            if(component[next] != component[entry]){ // leaving the component for good
+                top.wins += win_from[next];
+                if(arrivals != NULL){
+                    arrive[next] += *arrivals;
+                }
+            }
+            else if(!on_path[next]){
+                Frame child = {next, 0, BigCount(is_win[next]? 1 : 0)};
+                frames.push_back(child);
+                STATS_ADD(STATS_DFS_PUSHED, 1);
+                on_path[next] = true;
+            }
+            continue;
+        }
+        if(arrivals != NULL){
+            through[top.page] += *arrivals * top.wins;
+        }
+        on_path[top.page] = false;
+        BigCount wins = top.wins;
+        frames.pop_back();
+        STATS_ADD(STATS_DFS_POPPED, 1);
+        if(frames.empty()){
+            result = wins;
+        }
+        else{
+            frames.back().wins += wins;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief get the number of winning routes.
+ * 
+ * @return const BigCount& routes from page 1 to a WIN page.
+ */
+const BigCount & RouteCounter::getTotal() const{
+    return win_from[1];
+}
+
+/**
+ * @brief get the number of winning routes through a page.
+ * 
+ * @param pn page number.
+ * @return const BigCount& routes visiting the page.
+ */
+const BigCount & RouteCounter::getThrough(size_t pn) const{
+    return through[pn];
+}
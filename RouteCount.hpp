@@ -0,0 +1,43 @@
+#ifndef ROUTE_COUNT_HPP
+#define ROUTE_COUNT_HPP
+
+#include <vector>
+#include "BigCount.hpp"
+#include "StoryGraph.hpp"
+
+// counts the routes Story::getWinRoute would list, without listing them.
+//
+// A route never visits a page twice, but once it leaves a strongly
+// connected component it can never come back to it, so only the pages of
+// the current component on the path matter. The number of routes from a
+// page entering its component is therefore a fixed value, computed once
+// (components in reverse topological order); only the inside of cyclic
+// components is enumerated, and acyclic parts of the story cost linear time.
+class RouteCounter{
+public:
+    // constructor: is_win[pn] tells whether page pn is a WIN page.
+    RouteCounter(const StoryGraph & graph, const std::vector<bool> & is_win);
+
+    // count the routes from page 1 and through each page.
+    void count();
+
+    // get the number of winning routes.
+    const BigCount & getTotal() const;
+
+    // get the number of winning routes through a page.
+    const BigCount & getThrough(size_t pn) const;
+
+private:
+    // enumerate the paths inside the entry's component, starting at the entry.
+    BigCount countEntry(uint32_t entry, const BigCount * arrivals);
+
+    const StoryGraph & graph;
+    const std::vector<bool> & is_win;
+    std::vector<uint32_t> component; // component of each page, 0 if unreachable
+    std::vector<BigCount> win_from; // routes to WIN from an entry page, given no other page of its component is on the path
+    std::vector<BigCount> arrive; // routes from page 1 entering a component at a page
+    std::vector<BigCount> through; // routes through a page
+    std::vector<bool> on_path;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "RouteSearch.hpp"
+#include "Stats.hpp"
+
+#include <thread>
+
+/**
+ * @brief Construct a new RouteSearch object
+ * 
+ * @param graph the story graph.
+ * @param is_win whether each page is a WIN page, indexed by page number.
+ * @param can_win whether a WIN page can be reached from each page, indexed
+ * by page number.
+ * @param thread_num number of threads searching.
+ */
+RouteSearch::RouteSearch(const StoryGraph & graph, const std::vector<bool> & is_win, const std::vector<bool> & can_win, size_t thread_num): graph(graph), is_win(is_win), can_win(can_win), workers(), pending(0), queued(0), idle(0) {
+    for(size_t i = 0; i < (thread_num > 0? thread_num : 1); ++i){
+        Worker * worker = new Worker();
+        worker->on_path.assign(graph.getPageNum() + 1, false);
+        worker->subroute_num.assign(graph.getPageNum() + 1, 0);
+        workers.push_back(worker);
+    }
+}
+
+/**
+ * @brief Destroy the RouteSearch object
+ * 
+ */
+RouteSearch::~RouteSearch(){
+    for(size_t i = 0; i < workers.size(); ++i){
+        delete workers[i];
+    }
+}
+
+/**
+ * @brief list the routes, in the order of the sequential search.
+ * 
+ * @param paths the WIN way result(s) are appended here.
+ */
+void RouteSearch::run(std::vector<Route> & paths){
+    Task * root = new Task();
+    root->start = std::pair<uint32_t, uint32_t>(1, 0);
+    workers[0]->tasks.push_back(root);
+    pending = 1;
+    queued = 1;
+
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < workers.size(); ++i){
+        threads.push_back(std::thread(&RouteSearch::work, this, i));
+    }
+    work(0);
+    for(size_t i = 0; i < threads.size(); ++i){
+        threads[i].join();
+    }
+
+    // read the task tree in order: each chunk's routes, then its children.
+    struct Frame{
+        Task * task;
+        size_t chunk;
+        size_t child;
+    };
+    std::vector<Frame> frames;
+    Frame top = {root, 0, 0};
+    frames.push_back(top);
+    paths.insert(paths.end(), root->chunks[0].routes.begin(), root->chunks[0].routes.end());
+    while(!frames.empty()){
+        Frame & f = frames.back();
+        Chunk & chunk = f.task->chunks[f.chunk];
+        if(f.child < chunk.children.size()){
+            Task * child = chunk.children[f.child++];
+            Frame next = {child, 0, 0};
+            frames.push_back(next);
+            paths.insert(paths.end(), child->chunks[0].routes.begin(), child->chunks[0].routes.end());
+        }
+        else if(f.chunk + 1 < f.task->chunks.size()){
+            ++f.chunk;
+            f.child = 0;
+            paths.insert(paths.end(), f.task->chunks[f.chunk].routes.begin(), f.task->chunks[f.chunk].routes.end());
+        }
+        else{
+            delete f.task;
+            frames.pop_back();
+        }
+    }
+}
+
+/**
+ * @brief run tasks until none are left anywhere.
+ * 
+ * @param id the worker's index.
+ */
+void RouteSearch::work(size_t id){
+    bool is_idle = false;
+    while(pending.load() > 0){
+        Task * task = findTask(id);
+        if(task == NULL){
+            if(!is_idle){
+                ++idle;
+                is_idle = true;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        if(is_idle){
+            --idle;
+            is_idle = false;
+        }
+        search(*workers[id], task);
+        --pending;
+    }
+    if(is_idle){
+        --idle;
+    }
+}
+
+/**
+ * @brief take the newest task of the own deque, or steal the oldest task of
+ * another worker, which is usually the largest.
+ * 
+ * @param id the worker's index.
+ * @return RouteSearch::Task* the task, or NULL if no deque has one.
+ */
+RouteSearch::Task * RouteSearch::findTask(size_t id){
+    for(size_t k = 0; k < workers.size(); ++k){
+        Worker & victim = *workers[(id + k) % workers.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(!victim.tasks.empty()){
+            Task * task;
+            if(k == 0){
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+            }
+            else{
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+            }
+            --queued;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief walk one task's subtree, as Story::getWinRoute walks the whole story.
+ * When more workers are idle than tasks are queued, the choices of the page
+ * just reached become tasks instead of being pushed on the stack. Choices
+ * leading to pages that can't reach a WIN page are skipped: no route goes
+ * through them.
+ * 
+ * @param worker the worker's state.
+ * @param task the subtree.
+ */
+void RouteSearch::search(Worker & worker, Task * task){
+    std::vector<std::pair<uint32_t, uint32_t> > current_path(task->path); //(page num, choice num)
+    std::vector<std::pair<uint32_t, uint32_t> > waiting_do(1, task->start);
+    STATS_ADD(STATS_DFS_PUSHED, 1);
+    size_t base = current_path.size() + 1; // the prefix and the task's page stay on the path
+    for(size_t i = 0; i < current_path.size(); ++i){
+        worker.on_path[current_path[i].first] = true;
+    }
+    task->chunks.push_back(Chunk());
+
+    while(!waiting_do.empty()){
+        std::pair<uint32_t, uint32_t> current_p = waiting_do.back();
+        size_t current_index = current_p.first;
+        waiting_do.pop_back();
+        STATS_ADD(STATS_DFS_POPPED, 1);
+        if(!current_path.empty()){ //B assigns the second value of the preceding node A of the path.
+            current_path.back().second = current_p.second;
+        }
+
+        if(worker.on_path[current_index]){ // a loop back into the current path: this child is done
+            --worker.subroute_num[current_path.back().first];
+        }
+        else{
+            current_path.push_back(current_p);
+            STATS_PEAK(STATS_PEAK_PATH, current_path.size());
+            worker.on_path[current_index] = true;
+            Span<uint32_t> options = graph.getChoices(current_index);
+            worker.subroute_num[current_index] = options.size();
+
+            if(options.empty()){
+                if(is_win[current_index]){
+                    task->chunks.back().routes.push_back(Route(current_path.begin(), current_path.end()));
+                }
+            }
+            else if(idle.load(std::memory_order_relaxed) > queued.load(std::memory_order_relaxed)){
+                // hand the subtrees out; the stack would pop the last choice first.
+                std::vector<Task *> & children = task->chunks.back().children;
+                for(size_t i = options.size(); i-- > 0; ){
+                    if(!worker.on_path[options[i]] && can_win[options[i]]){
+                        Task * child = new Task();
+                        child->path = current_path;
+                        child->start = std::pair<uint32_t, uint32_t>(options[i], i + 1);
+                        children.push_back(child);
+                    }
+                }
+                pending += children.size();
+                {
+                    std::lock_guard<std::mutex> guard(worker.lock);
+                    worker.tasks.insert(worker.tasks.end(), children.begin(), children.end());
+                    queued += children.size();
+                }
+                task->chunks.push_back(Chunk());
+                worker.subroute_num[current_index] = 0;
+            }
+            else{
+                size_t pushed = 0;
+                for(size_t i = 0; i < options.size(); ++i){
+                    if(can_win[options[i]]){
+                        waiting_do.push_back(std::pair<uint32_t, uint32_t>(options[i], i + 1));
+                        ++pushed;
+                    }
+                }
+                worker.subroute_num[current_index] = pushed;
+                STATS_ADD(STATS_DFS_PUSHED, pushed);
+                STATS_ADD(STATS_DFS_PRUNED, options.size() - pushed);
+            }
+        }
+        while(worker.subroute_num[current_path.back().first] == 0 && current_path.size() > base){
+            worker.on_path[current_path.back().first] = false;
+            current_path.pop_back(); // The "leaf" page is deleted from the current path
+            --worker.subroute_num[current_path.back().first];
+        }
+    }
+    for(size_t i = 0; i < current_path.size(); ++i){
+        worker.on_path[current_path[i].first] = false;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef ROUTE_SEARCH_HPP
+#define ROUTE_SEARCH_HPP
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "StoryGraph.hpp"
+
+// a WIN way: (page num, choice num) for each page, choice 0 on the WIN page.
+typedef std::vector<std::pair<size_t, size_t> > Route;
+
+// lists every route from page 1 to a WIN page that never visits a page twice,
+// last choice explored first. Choices leading to pages that reach no WIN page
+// are never followed.
+//
+// The search is a depth-first walk with an explicit stack. With more than one
+// thread, a worker that finds others idle hands the subtrees under its
+// current page out as tasks; each worker owns a deque of tasks and idle
+// workers steal the oldest task of another. Every task records its routes in
+// chunks, and each chunk is followed by the tasks split off at its end, so
+// reading the task tree in order yields the routes in the sequential order.
+class RouteSearch{
+public:
+    // constructor: is_win[pn] tells whether page pn is a WIN page, can_win[pn]
+    // whether a WIN page can be reached from it, as StoryGraph::findWinnable finds.
+    RouteSearch(const StoryGraph & graph, const std::vector<bool> & is_win, const std::vector<bool> & can_win, size_t thread_num);
+    // destructor
+    ~RouteSearch();
+
+    // list the routes, in the order of the sequential search.
+    void run(std::vector<Route> & paths);
+
+private:
+    struct Task;
+
+    // routes found by a task, then the tasks split off after them.
+    struct Chunk{
+        std::vector<Route> routes;
+        std::vector<Task *> children;
+    };
+
+    // the subtree under start, reached through path.
+    struct Task{
+        std::vector<std::pair<uint32_t, uint32_t> > path; // (page num, choice num)
+        std::pair<uint32_t, uint32_t> start; // (page num, choice num leading to it)
+        std::vector<Chunk> chunks;
+    };
+
+    // per-thread search state.
+    struct Worker{
+        std::deque<Task *> tasks;
+        std::mutex lock;
+        std::vector<bool> on_path;
+        std::vector<uint32_t> subroute_num; // children of a path page not yet traversed
+    };
+
+    RouteSearch(const RouteSearch &);
+    RouteSearch & operator=(const RouteSearch &);
+
+    // run tasks until none are left anywhere.
+    void work(size_t id);
+
+    // take a task from the own deque, or steal one.
+    Task * findTask(size_t id);
+
+    // walk one task's subtree.
+    void search(Worker & worker, Task * task);
+
+    const StoryGraph & graph;
+    const std::vector<bool> & is_win;
+    const std::vector<bool> & can_win;
+    std::vector<Worker *> workers;
+    std::atomic<size_t> pending; // tasks created but not finished
+    std::atomic<size_t> queued; // tasks waiting in a deque
+    std::atomic<size_t> idle; // workers looking for a task
+};
+
+#endif
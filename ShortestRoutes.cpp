@@ -0,0 +1,144 @@
+#include "ShortestRoutes.hpp"
+
+#include <algorithm>
+#include <set>
+
+/**
+ * @brief Construct a new ShortestRoutes object
+ * 
+ * @param graph the story graph.
+ * @param is_win whether each page is a WIN page, indexed by page number.
+ * @param can_win whether a WIN page can be reached from each page, indexed
+ * by page number.
+ */
+ShortestRoutes::ShortestRoutes(const StoryGraph & graph, const std::vector<bool> & is_win, const std::vector<bool> & can_win):
+    graph(graph), is_win(is_win), can_win(can_win), blocked(graph.getPageNum() + 1, 0), seen(graph.getPageNum() + 1, 0),
+    parent(graph.getPageNum() + 1), blocked_choice(), stamp(0) {}
+
+/**
+ * @brief rank two ways: the one with fewer choices first, then the one whose
+ * first differing choice number is lower.
+ * 
+ * @param a a way.
+ * @param b another way.
+ * @return true a is ranked before b.
+ * @return false it is not.
+ */
+bool ShortestRoutes::WayLess::operator()(const Way & a, const Way & b) const{
+    if(a.choices.size() != b.choices.size()){
+        return a.choices.size() < b.choices.size();
+    }
+    return a.choices < b.choices;
+}
+
+/**
+ * @brief find the best ranked of the shortest ways from a page to a WIN page,
+ * not going through the blocked pages, nor through the blocked choices of
+ * the start page. Pages are expanded level by level, in the rank order of
+ * the ways reaching them and each page's choices in order, so the first
+ * time a page is reached is by its best ranked shortest way. Pages that
+ * can't reach a WIN page at all are never entered.
+ * 
+ * @param start the page to start from; not blocked.
+ * @param way filled with the way found, start first.
+ * @return true a way was found.
+ * @return false every WIN page is cut off.
+ */
+bool ShortestRoutes::findSpur(uint32_t start, Way & way){
+    seen[start] = stamp;
+    uint32_t found = 0;
+    if(is_win[start]){
+        found = start;
+    }
+    std::vector<uint32_t> queue(1, start);
+    for(size_t head = 0; head < queue.size() && found == 0; ++head){
+        uint32_t pn = queue[head];
+        Span<uint32_t> options = graph.getChoices(pn);
+        for(size_t i = 0; i < options.size(); ++i){
+            uint32_t next = options[i];
+            if(seen[next] == stamp || blocked[next] == stamp || !can_win[next]
+               || (pn == start && i < blocked_choice.size() && blocked_choice[i])){
+                continue;
+            }
+            seen[next] = stamp;
+            parent[next] = std::pair<uint32_t, uint32_t>(pn, i + 1);
+            if(is_win[next]){
+                found = next;
+                break;
+            }
+            queue.push_back(next);
+        }
+    }
+    if(found == 0){
+        return false;
+    }
+
+    way.pages.clear();
+    way.choices.clear();
+    for(uint32_t pn = found; pn != start; pn = parent[pn].first){
+        way.pages.push_back(pn);
+        way.choices.push_back(parent[pn].second);
+    }
+    way.pages.push_back(start);
+    std::reverse(way.pages.begin(), way.pages.end());
+    std::reverse(way.choices.begin(), way.choices.end());
+    return true;
+}
+
+/**
+ * @brief find up to k routes from page 1 to a WIN page, best ranked first.
+ * Route j + 1 is the best of the candidates: for each page i of route j, the
+ * pages before it are blocked, so are the choices at page i of the routes
+ * already found that start like route j up to page i, and the shortest way
+ * on from page i is added to the start of route j.
+ * 
+ * @param k the number of routes wanted.
+ * @param routes the routes found are appended here, in the format of
+ * Story::getWinRoute.
+ */
+void ShortestRoutes::find(size_t k, std::vector<Route> & routes){
+    std::vector<Way> found;
+    std::set<Way, WayLess> candidates;
+    Way way;
+    ++stamp;
+    if(k > 0 && can_win[1] && findSpur(1, way)){
+        found.push_back(way);
+    }
+    while(!found.empty() && found.size() < k){
+        const Way last = found.back();
+        for(size_t i = 0; i + 1 < last.pages.size(); ++i){
+            uint32_t spur = last.pages[i];
+            ++stamp;
+            for(size_t j = 0; j < i; ++j){
+                blocked[last.pages[j]] = stamp;
+            }
+            blocked_choice.assign(graph.getChoices(spur).size(), false);
+            for(size_t f = 0; f < found.size(); ++f){
+                const Way & other = found[f];
+                if(other.choices.size() > i && std::equal(last.choices.begin(), last.choices.begin() + i, other.choices.begin())){
+                    blocked_choice[other.choices[i] - 1] = true;
+                }
+            }
+            if(!findSpur(spur, way)){
+                continue;
+            }
+            way.pages.insert(way.pages.begin(), last.pages.begin(), last.pages.begin() + i);
+            way.choices.insert(way.choices.begin(), last.choices.begin(), last.choices.begin() + i);
+            candidates.insert(way);
+        }
+        if(candidates.empty()){
+            break;
+        }
+        found.push_back(*candidates.begin());
+        candidates.erase(candidates.begin());
+    }
+
+    for(size_t f = 0; f < found.size(); ++f){
+        Route route;
+        for(size_t i = 0; i < found[f].choices.size(); ++i){
+            route.push_back(std::pair<size_t, size_t>(found[f].pages[i], found[f].choices[i]));
+        }
+        route.push_back(std::pair<size_t, size_t>(found[f].pages.back(), 0));
+        routes.push_back(route);
+    }
+}
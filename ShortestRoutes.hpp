@@ -0,0 +1,51 @@
+#ifndef SHORTEST_ROUTES_HPP
+#define SHORTEST_ROUTES_HPP
+
+#include <vector>
+#include "RouteSearch.hpp"
+#include "StoryGraph.hpp"
+
+// finds the K shortest routes from page 1 to a WIN page that never visit a
+// page twice, with Yen's algorithm: each route after the first leaves an
+// earlier one at some page and takes the shortest way to a WIN page from
+// there that avoids the pages before it and the choices the earlier routes
+// took at it. Only about K times the route length searches of the story are
+// made, however many routes there are in all.
+//
+// Routes are ranked by their number of choices, then by their choice
+// numbers from page 1 on, so the ranking is the same on every run.
+class ShortestRoutes{
+public:
+    // constructor: is_win[pn] tells whether page pn is a WIN page, can_win[pn]
+    // whether a WIN page can be reached from it.
+    ShortestRoutes(const StoryGraph & graph, const std::vector<bool> & is_win, const std::vector<bool> & can_win);
+
+    // find up to k routes, shortest first.
+    void find(size_t k, std::vector<Route> & routes);
+
+private:
+    // a route as its pages and the choice numbers taken on them.
+    struct Way{
+        std::vector<uint32_t> pages; // page 1 first, a WIN page last
+        std::vector<uint32_t> choices; // choices[i] leads from pages[i] to pages[i + 1]
+    };
+
+    // ranks ways by their length, then by their choice numbers.
+    struct WayLess{
+        bool operator()(const Way & a, const Way & b) const;
+    };
+
+    // the shortest way from a page to a WIN page avoiding the blocked pages and choices.
+    bool findSpur(uint32_t start, Way & way);
+
+    const StoryGraph & graph;
+    const std::vector<bool> & is_win;
+    const std::vector<bool> & can_win;
+    std::vector<uint32_t> blocked; // pages blocked for the current search, marked with its stamp
+    std::vector<uint32_t> seen; // pages reached by the current search, marked with its stamp
+    std::vector<std::pair<uint32_t, uint32_t> > parent; // (page, choice num) each page was reached from
+    std::vector<bool> blocked_choice; // choices of the start page that are blocked, by choice num
+    uint32_t stamp; // the current search
+};
+
+#endif
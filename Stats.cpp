@@ -0,0 +1,113 @@
+#include "Stats.hpp"
+#include "Page.hpp"
+
+#ifdef CYOA_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+static std::atomic<uint64_t> counters[STATS_COUNTER_NUM];
+static std::atomic<uint64_t> peaks[STATS_PEAK_NUM];
+static std::atomic<uint64_t> phase_ns[STATS_PHASE_NUM];
+
+static const char * const COUNTER_NAMES[STATS_COUNTER_NUM] = {
+    "files_opened", "bytes_read", "bytes_mapped", "pages_loaded", "dfs_pushed", "dfs_popped", "dfs_pruned"
+};
+static const char * const PEAK_NAMES[STATS_PEAK_NUM] = {
+    "peak_path_length"
+};
+static const char * const PHASE_NAMES[STATS_PHASE_NUM] = {
+    "load", "checkPages", "getPageDepth", "getWinRoute", "countRoutes", "structure", "replay", "output"
+};
+
+/**
+ * @brief nanoseconds on a monotonic clock.
+ * 
+ * @return uint64_t the time.
+ */
+static uint64_t nowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief add to a counter.
+ * 
+ * @param counter the counter.
+ * @param n the amount.
+ */
+void statsAdd(StatsCounter counter, uint64_t n){
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief raise a peak to the value, if it is larger.
+ * 
+ * @param peak the peak.
+ * @param value the value seen.
+ */
+void statsPeak(StatsPeak peak, uint64_t value){
+    uint64_t seen = peaks[peak].load(std::memory_order_relaxed);
+    while(value > seen && !peaks[peak].compare_exchange_weak(seen, value, std::memory_order_relaxed)){}
+}
+
+/**
+ * @brief Construct a new StatsTimer object, starting the clock.
+ * 
+ * @param phase the phase timed.
+ */
+StatsTimer::StatsTimer(StatsPhase phase): phase(phase), start(nowNs()) {}
+
+/**
+ * @brief Destroy the StatsTimer object, adding the time to its phase.
+ * 
+ */
+StatsTimer::~StatsTimer(){
+    phase_ns[phase].fetch_add(nowNs() - start, std::memory_order_relaxed);
+}
+
+/**
+ * @brief print the report to stderr as one JSON object.
+ * 
+ */
+static void printStats(){
+    fprintf(stderr, "{\"phases_ms\":{");
+    for(size_t i = 0; i < STATS_PHASE_NUM; ++i){
+        fprintf(stderr, "%s\"%s\":%.3f", i? "," : "", PHASE_NAMES[i], phase_ns[i].load() / 1e6);
+    }
+    fprintf(stderr, "}");
+    for(size_t i = 0; i < STATS_COUNTER_NUM; ++i){
+        fprintf(stderr, ",\"%s\":%llu", COUNTER_NAMES[i], (unsigned long long)counters[i].load());
+    }
+    for(size_t i = 0; i < STATS_PEAK_NUM; ++i){
+        fprintf(stderr, ",\"%s\":%llu", PEAK_NAMES[i], (unsigned long long)peaks[i].load());
+    }
+    uint64_t load_ns = phase_ns[STATS_LOAD].load();
+    fprintf(stderr, ",\"pages_per_sec\":%.1f", load_ns? counters[STATS_PAGES_LOADED].load() * 1e9 / load_ns : 0.0);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(stderr, ",\"peak_rss_kb\":%ld}\n", usage.ru_maxrss);
+}
+
+/**
+ * @brief print the report to stderr when the program exits, however it exits.
+ * 
+ */
+void enableStats(){
+    atexit(printStats);
+}
+
+#else
+
+/**
+ * @brief without CYOA_STATS there is nothing to report.
+ * 
+ */
+void enableStats(){
+    findError("--stats needs a build with make STATS=1!");
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <stdint.h>
+#include <cstddef>
+
+// run statistics, compiled in only with -DCYOA_STATS (make STATS=1). The
+// STATS_* macros expand to nothing otherwise, arguments included, so a
+// normal build pays nothing for them.
+
+// counted quantities.
+enum StatsCounter{
+    STATS_FILES_OPENED,
+    STATS_BYTES_READ,
+    STATS_BYTES_MAPPED,
+    STATS_PAGES_LOADED,
+    STATS_DFS_PUSHED,
+    STATS_DFS_POPPED,
+    STATS_DFS_PRUNED,
+    STATS_COUNTER_NUM
+};
+
+// quantities whose largest value is kept.
+enum StatsPeak{
+    STATS_PEAK_PATH,
+    STATS_PEAK_NUM
+};
+
+// timed phases.
+enum StatsPhase{
+    STATS_LOAD,
+    STATS_CHECK_PAGES,
+    STATS_PAGE_DEPTH,
+    STATS_WIN_ROUTE,
+    STATS_COUNT_ROUTES,
+    STATS_STRUCTURE,
+    STATS_REPLAY,
+    STATS_OUTPUT,
+    STATS_PHASE_NUM
+};
+
+// print the report to stderr when the program exits; an error without CYOA_STATS.
+void enableStats();
+
+#ifdef CYOA_STATS
+
+// add to a counter.
+void statsAdd(StatsCounter counter, uint64_t n);
+
+// raise a peak to the value, if it is larger.
+void statsPeak(StatsPeak peak, uint64_t value);
+
+// adds the wall time of its scope to a phase.
+class StatsTimer{
+public:
+    StatsTimer(StatsPhase phase);
+    ~StatsTimer();
+
+private:
+    StatsPhase phase;
+    uint64_t start; // nanoseconds
+};
+
+#define STATS_ADD(counter, n) statsAdd(counter, n)
+#define STATS_PEAK(peak, value) statsPeak(peak, value)
+#define STATS_PHASE(phase) StatsTimer stats_timer(phase)
+
+#else
+
+#define STATS_ADD(counter, n) do{}while(0)
+#define STATS_PEAK(peak, value) do{}while(0)
+#define STATS_PHASE(phase) do{}while(0)
+
+#endif
+
+#endif
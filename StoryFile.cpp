@@ -0,0 +1,270 @@
+#include "StoryFile.hpp"
+#include "Stats.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief round the offset up to the section alignment.
+ * 
+ * @param offset byte offset.
+ * @return uint64_t the aligned offset.
+ */
+static uint64_t alignSection(uint64_t offset){
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+/**
+ * @brief write one section, padded up to the section alignment.
+ * 
+ * @param f the output stream.
+ * @param data section bytes.
+ * @param len section length.
+ */
+static void writeSection(std::ofstream & f, const void * data, size_t len){
+    static const char padding[8] = {0};
+    f.write((const char *)data, len);
+    f.write(padding, alignSection(len) - len);
+}
+
+// ===================================================
+
+//                  StoryFile Class
+
+// ===================================================
+/**
+ * @brief Construct a new StoryFile::StoryFile object
+ * 
+ */
+StoryFile::StoryFile(): base(NULL), size(0), header(NULL), types(NULL), choices(NULL), targets(NULL), labels(NULL), texts(NULL), blob(NULL) {}
+
+/**
+ * @brief Destroy the StoryFile::StoryFile object
+ * 
+ */
+StoryFile::~StoryFile(){
+    if(base != NULL){
+        munmap((void *)base, size);
+    }
+}
+
+/**
+ * @brief map the compiled story and check its layout.
+ * 
+ * @param file_name the compiled story file.
+ */
+void StoryFile::open(const std::string & file_name){
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if(fd < 0){
+        findError("file open unsuccessfully!");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StoryFileHeader)){
+        close(fd);
+        findError("The compiled story is truncated!");
+    }
+    size = st.st_size;
+    STATS_ADD(STATS_FILES_OPENED, 1);
+    STATS_ADD(STATS_BYTES_MAPPED, size);
+    void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        findError("The compiled story cannot be mapped!");
+    }
+    base = (const char *)mapping;
+    checkLayout();
+}
+
+/**
+ * @brief check that a section fits between its offset and the next one's,
+ * without any sum that could wrap around.
+ * 
+ * @param offset the section's offset.
+ * @param count number of elements.
+ * @param elem_size size of one element.
+ * @param end the next section's offset.
+ * @return true the section fits.
+ * @return false it starts after end or runs past it.
+ */
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t elem_size, uint64_t end){
+    return offset <= end && count <= (end - offset) / elem_size;
+}
+
+/**
+ * @brief check the header and every section of the mapping, so that no later
+ * access can leave the file. Each section must fit before the next one
+ * starts, and the blob before the end of the file.
+ * 
+ */
+void StoryFile::checkLayout(){
+    header = (const StoryFileHeader *)base;
+    if(memcmp(header->magic, STORY_FILE_MAGIC, sizeof(header->magic)) != 0){
+        findError("This is not a compiled story!");
+    }
+    if(header->version != STORY_FILE_VERSION || header->byte_order != STORY_FILE_BYTE_ORDER){
+        findError("The compiled story was written by an incompatible version!");
+    }
+    uint64_t pn = header->page_num, cn = header->choice_num;
+    if(header->file_size != size || pn == 0
+       || header->blob_size > size || header->blob_offset > size - header->blob_size
+       || header->types_offset < sizeof(StoryFileHeader)
+       || !sectionFits(header->types_offset, pn, 1, header->choices_offset)
+       || !sectionFits(header->choices_offset, pn + 1, sizeof(uint32_t), header->targets_offset)
+       || !sectionFits(header->targets_offset, cn, sizeof(uint32_t), header->labels_offset)
+       || !sectionFits(header->labels_offset, cn + 1, sizeof(uint64_t), header->texts_offset)
+       || !sectionFits(header->texts_offset, pn + 1, sizeof(uint64_t), header->blob_offset)
+       || header->choices_offset % 8 || header->targets_offset % 8 || header->labels_offset % 8 || header->texts_offset % 8){
+        findError("The compiled story is truncated!");
+    }
+    types = (const uint8_t *)(base + header->types_offset);
+    choices = (const uint32_t *)(base + header->choices_offset);
+    targets = (const uint32_t *)(base + header->targets_offset);
+    labels = (const uint64_t *)(base + header->labels_offset);
+    texts = (const uint64_t *)(base + header->texts_offset);
+    blob = base + header->blob_offset;
+
+    if(choices[0] != 0 || choices[pn] != cn || labels[0] != 0 || labels[cn] > texts[0] || texts[pn] != header->blob_size){
+        findError("The compiled story is truncated!");
+    }
+    for(size_t i = 0; i < pn; ++i){
+        size_t choice_num = choices[i + 1] - choices[i];
+        if(choices[i + 1] < choices[i] || texts[i + 1] < texts[i] || types[i] > PAGE_LOSE
+           || (types[i] == PAGE_CHOICE) != (choice_num > 0)){
+            findError("The compiled story has an illegal page!");
+        }
+    }
+    for(size_t j = 0; j < cn; ++j){
+        if(targets[j] == 0 || targets[j] > pn || labels[j + 1] < labels[j]){
+            findError("The compiled story has an illegal page!");
+        }
+    }
+}
+
+/**
+ * @brief check whether a story is mapped.
+ * 
+ * @return true a compiled story is mapped.
+ * @return false nothing is mapped.
+ */
+bool StoryFile::isOpen() const{
+    return base != NULL;
+}
+
+/**
+ * @brief get the number of pages.
+ * 
+ * @return size_t page number.
+ */
+size_t StoryFile::getPageNum() const{
+    return header->page_num;
+}
+
+/**
+ * @brief get the number of choices over all pages.
+ * 
+ * @return size_t choice number.
+ */
+size_t StoryFile::getChoiceNum() const{
+    return header->choice_num;
+}
+
+/**
+ * @brief get the index of each page's first choice.
+ * 
+ * @return const uint32_t* page number + 1 entries, in the mapping.
+ */
+const uint32_t * StoryFile::getChoiceIndex() const{
+    return choices;
+}
+
+/**
+ * @brief get the page number each choice leads to.
+ * 
+ * @return const uint32_t* one entry per choice, in the mapping.
+ */
+const uint32_t * StoryFile::getTargets() const{
+    return targets;
+}
+
+/**
+ * @brief use the mapped types, labels and texts as the story's pages; the
+ * blob is laid out as their arena already.
+ * 
+ * @param pages the story's pages, attached to the mapping.
+ */
+void StoryFile::attachPages(StoryPages & pages) const{
+    pages.attach(header->page_num, header->choice_num, types, labels, texts, blob, header->blob_size);
+}
+
+/**
+ * @brief write a story as a compiled story file. The blob is the pages'
+ * arena as it is, so only the choice arrays need narrowing to 32 bits.
+ * 
+ * @param file_name the output file.
+ * @param pages the story's pages.
+ * @param graph the story's choices.
+ */
+void StoryFile::write(const std::string & file_name, const StoryPages & pages, const StoryGraph & graph){
+    size_t page_num = pages.getPageNum(), choice_num = pages.getChoiceNum();
+    std::vector<uint32_t> choice_section(page_num + 1);
+    std::vector<uint32_t> target_section;
+    target_section.reserve(choice_num);
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        choice_section[pn - 1] = target_section.size();
+        Span<uint32_t> options = graph.getChoices(pn);
+        target_section.insert(target_section.end(), options.begin(), options.end());
+    }
+    choice_section[page_num] = target_section.size();
+    Span<char> blob = pages.getArena();
+
+    StoryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORY_FILE_MAGIC, sizeof(header.magic));
+    header.version = STORY_FILE_VERSION;
+    header.byte_order = STORY_FILE_BYTE_ORDER;
+    header.page_num = page_num;
+    header.choice_num = choice_num;
+    header.types_offset = alignSection(sizeof(header));
+    header.choices_offset = alignSection(header.types_offset + page_num);
+    header.targets_offset = alignSection(header.choices_offset + (page_num + 1) * sizeof(uint32_t));
+    header.labels_offset = alignSection(header.targets_offset + choice_num * sizeof(uint32_t));
+    header.texts_offset = alignSection(header.labels_offset + (choice_num + 1) * sizeof(uint64_t));
+    header.blob_offset = alignSection(header.texts_offset + (page_num + 1) * sizeof(uint64_t));
+    header.blob_size = blob.size();
+    header.file_size = header.blob_offset + header.blob_size;
+
+    std::ofstream f(file_name.c_str(), std::ios::binary | std::ios::trunc);
+    if(!f.is_open()){
+        findError("file open unsuccessfully!");
+    }
+    writeSection(f, &header, sizeof(header));
+    writeSection(f, pages.getTypes(), page_num);
+    writeSection(f, choice_section.data(), choice_section.size() * sizeof(uint32_t));
+    writeSection(f, target_section.data(), target_section.size() * sizeof(uint32_t));
+    writeSection(f, pages.getLabelOffsets(), (choice_num + 1) * sizeof(uint64_t));
+    writeSection(f, pages.getTextOffsets(), (page_num + 1) * sizeof(uint64_t));
+    f.write(blob.begin(), blob.size());
+    if(!f.good()){
+        findError("The compiled story cannot be written!");
+    }
+}
+
+/**
+ * @brief check whether the path names a compiled story file.
+ * 
+ * @param path a story directory or a compiled story.
+ * @return true it is a regular file starting with the compiled story magic.
+ * @return false otherwise.
+ */
+bool isStoryFile(const std::string & path){
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)){
+        return false;
+    }
+    char magic[8];
+    std::ifstream f(path.c_str(), std::ios::binary);
+    return f.read(magic, sizeof(magic)) && memcmp(magic, STORY_FILE_MAGIC, sizeof(magic)) == 0;
+}
@@ -0,0 +1,87 @@
+#ifndef STORY_FILE_HPP
+#define STORY_FILE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Page.hpp"
+#include "StoryGraph.hpp"
+#include "StoryPages.hpp"
+
+// compiled story format identification.
+#define STORY_FILE_MAGIC "CYOABIN"
+#define STORY_FILE_VERSION 1
+#define STORY_FILE_BYTE_ORDER 0x01020304u
+
+// header at the start of a compiled story. Every section offset is
+// relative to the start of the file and aligned to 8 bytes.
+struct StoryFileHeader{
+    char magic[8];            // STORY_FILE_MAGIC
+    uint32_t version;         // STORY_FILE_VERSION
+    uint32_t byte_order;      // STORY_FILE_BYTE_ORDER in the writer's byte order
+    uint32_t page_num;        // number of pages
+    uint32_t choice_num;      // number of choices over all pages
+    uint64_t types_offset;    // uint8_t[page_num], PageType of each page
+    uint64_t choices_offset;  // uint32_t[page_num + 1], index of each page's first choice
+    uint64_t targets_offset;  // uint32_t[choice_num], page number each choice leads to
+    uint64_t labels_offset;   // uint64_t[choice_num + 1], blob offset of each choice label, plus the end
+    uint64_t texts_offset;    // uint64_t[page_num + 1], blob offset of each page's text, plus the end
+    uint64_t blob_offset;     // char[blob_size], labels and texts
+    uint64_t blob_size;
+    uint64_t file_size;
+};
+
+// a compiled story, memory-mapped read-only.
+class StoryFile{
+public:
+    // default constructor
+    StoryFile();
+    // destructor
+    ~StoryFile();
+
+    // map the compiled story and check its layout.
+    void open(const std::string & file_name);
+
+    // check whether a story is mapped.
+    bool isOpen() const;
+
+    // get the number of pages.
+    size_t getPageNum() const;
+
+    // get the number of choices over all pages.
+    size_t getChoiceNum() const;
+
+    // get the index of each page's first choice, page number + 1 entries.
+    const uint32_t * getChoiceIndex() const;
+
+    // get the page number each choice leads to.
+    const uint32_t * getTargets() const;
+
+    // use the mapped types, labels and texts as the story's pages.
+    void attachPages(StoryPages & pages) const;
+
+    // write a story as a compiled story file.
+    static void write(const std::string & file_name, const StoryPages & pages, const StoryGraph & graph);
+
+private:
+    StoryFile(const StoryFile &);
+    StoryFile & operator=(const StoryFile &);
+
+    // check the header and every section of the mapping.
+    void checkLayout();
+
+    const char * base; // start of the mapping
+    size_t size; // mapping length
+    const StoryFileHeader * header;
+    const uint8_t * types;
+    const uint32_t * choices;
+    const uint32_t * targets;
+    const uint64_t * labels;
+    const uint64_t * texts;
+    const char * blob;
+};
+
+// check whether the path names a compiled story file.
+bool isStoryFile(const std::string & path);
+
+#endif
@@ -0,0 +1,174 @@
+#include "StoryGen.hpp"
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <sys/stat.h>
+
+/**
+ * @brief Construct a new StoryGenerator::StoryGenerator object
+ * 
+ * @param page_num number of pages, at least 3.
+ * @param branch most choices of a choice page.
+ * @param cycle_percent share of the choices leading back to an earlier page.
+ * @param ending_percent share of the pages after page 1 that are WIN or LOSE pages.
+ * @param win_percent share of those that are WIN pages.
+ * @param chain each page is chosen by the last choice page before it,
+ * instead of a random earlier one.
+ * @param seed pseudo-random seed.
+ */
+StoryGenerator::StoryGenerator(size_t page_num, size_t branch, size_t cycle_percent, size_t ending_percent,
+                               size_t win_percent, bool chain, uint64_t seed):
+    page_num(page_num), branch(branch), cycle_percent(cycle_percent), ending_percent(ending_percent),
+    win_percent(win_percent), chain(chain), state(seed), types(), choices() {
+    if(page_num < 3){
+        findError("A story needs at least 3 pages!");
+    }
+    if(page_num > UINT32_MAX){
+        findError("The story has too many pages!");
+    }
+}
+
+/**
+ * @brief next pseudo-random number (splitmix64), the same on every platform.
+ * 
+ * @return uint64_t the number.
+ */
+uint64_t StoryGenerator::next(){
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief pseudo-random number below n.
+ * 
+ * @param n the bound, at least 1.
+ * @return size_t 0 to n - 1.
+ */
+size_t StoryGenerator::below(size_t n){
+    return next() % n;
+}
+
+/**
+ * @brief true with the given percentage.
+ * 
+ * @param percent 0 to 100.
+ * @return true in percent of the calls.
+ */
+bool StoryGenerator::chance(size_t percent){
+    return below(100) < percent;
+}
+
+/**
+ * @brief pick every page's type and choices. Each page after page 1 first
+ * gets a random earlier choice page choosing it, or the last one with chain,
+ * so every page is referenced and reachable; choice pages are then filled
+ * up to their number of choices with forward choices, or with backward
+ * ones, which make the cycles.
+ * 
+ */
+void StoryGenerator::generate(){
+    types.assign(page_num, PAGE_CHOICE);
+    choices.assign(page_num, std::vector<uint32_t>());
+
+    // endings: at least two, at least one of each kind.
+    std::vector<size_t> endings;
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        if(chance(ending_percent)){
+            endings.push_back(pn);
+        }
+    }
+    if(endings.size() < 2){
+        endings.clear();
+        endings.push_back(page_num - 1);
+        endings.push_back(page_num);
+    }
+    size_t win_num = 0;
+    for(size_t i = 0; i < endings.size(); ++i){
+        types[endings[i] - 1] = chance(win_percent)? PAGE_WIN : PAGE_LOSE;
+        win_num += types[endings[i] - 1] == PAGE_WIN;
+    }
+    if(win_num == 0){
+        types[endings.front() - 1] = PAGE_WIN;
+    }
+    else if(win_num == endings.size()){
+        types[endings.back() - 1] = PAGE_LOSE;
+    }
+
+    // a referrer for every page.
+    std::vector<uint32_t> choosers(1, 1); // choice pages so far
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        choices[(chain? choosers.back() : choosers[below(choosers.size())]) - 1].push_back(pn);
+        if(types[pn - 1] == PAGE_CHOICE){
+            choosers.push_back(pn);
+        }
+    }
+
+    // the other choices, in random order.
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        if(types[pn - 1] != PAGE_CHOICE){
+            continue;
+        }
+        std::vector<uint32_t> & page = choices[pn - 1];
+        size_t choice_num = 1 + below(branch);
+        while(page.size() < choice_num){
+            if(pn == page_num || chance(cycle_percent)){
+                page.push_back(1 + below(pn));
+            }
+            else{
+                page.push_back(pn + 1 + below(page_num - pn));
+            }
+        }
+        for(size_t i = page.size(); i > 1; --i){
+            std::swap(page[i - 1], page[below(i)]);
+        }
+    }
+}
+
+/**
+ * @brief write the story as page1.txt, page2.txt, ... in dir, which is
+ * created if missing. A longer story already there is an error, since its
+ * extra pages would become part of this one.
+ * 
+ * @param dir the story directory.
+ * @param text_lines lines of text per page.
+ * @param thread_num number of threads writing pages.
+ */
+void StoryGenerator::write(const std::string & dir, size_t text_lines, size_t thread_num) const{
+    if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST){
+        findError("The story directory cannot be created!");
+    }
+    struct stat st;
+    if(stat((dir + "/page" + std::to_string(page_num + 1) + ".txt").c_str(), &st) == 0){
+        findError("The story directory already holds a longer story!");
+    }
+
+    std::atomic<bool> failed(false);
+    parallelFor(page_num, thread_num, [&](size_t i){
+        size_t pn = i + 1;
+        std::string page;
+        if(types[i] == PAGE_CHOICE){
+            for(size_t j = 0; j < choices[i].size(); ++j){
+                page += std::to_string(choices[i][j]) + ":Go on to page " + std::to_string(choices[i][j]) + ".\n";
+            }
+        }
+        else{
+            page += types[i] == PAGE_WIN? "WIN\n" : "LOSE\n";
+        }
+        page += "#\n";
+        for(size_t line = 0; line < text_lines; ++line){
+            page += "This is line " + std::to_string(line + 1) + " of page " + std::to_string(pn)
+                    + " of a generated story, where the reader has to decide what happens next.\n";
+        }
+        std::ofstream f((dir + "/page" + std::to_string(pn) + ".txt").c_str(), std::ios::binary | std::ios::trunc);
+        f.write(page.data(), page.size());
+        if(!f.good()){
+            failed = true;
+        }
+    });
+    if(failed){
+        findError("The story cannot be written!");
+    }
+}
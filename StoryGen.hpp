@@ -0,0 +1,49 @@
+#ifndef STORY_GEN_HPP
+#define STORY_GEN_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Page.hpp"
+
+// writes random valid stories: page 1 is a choice page, every other page is
+// chosen by an earlier choice page, and there is at least one WIN and one
+// LOSE page. The same settings and seed give the same story.
+class StoryGenerator{
+public:
+    // constructor: choice pages get 1 to branch choices; cycle_percent of the
+    // choices lead back to an earlier page, ending_percent of the pages after
+    // page 1 are WIN or LOSE pages, and win_percent of those are WIN pages.
+    // With chain, each page is chosen by the last choice page before it, so
+    // the story is as deep as it is long.
+    StoryGenerator(size_t page_num, size_t branch, size_t cycle_percent, size_t ending_percent, size_t win_percent,
+                   bool chain, uint64_t seed);
+
+    // pick every page's type and choices.
+    void generate();
+
+    // write the story as page files, text_lines lines of text per page.
+    void write(const std::string & dir, size_t text_lines, size_t thread_num) const;
+
+private:
+    // next pseudo-random number.
+    uint64_t next();
+
+    // pseudo-random number below n.
+    size_t below(size_t n);
+
+    // true with the given percentage.
+    bool chance(size_t percent);
+
+    size_t page_num;
+    size_t branch;
+    size_t cycle_percent;
+    size_t ending_percent;
+    size_t win_percent;
+    bool chain; // each page is chosen by the choice page before it
+    uint64_t state; // generator state
+    std::vector<PageType> types; // type of each page, indexed by page number - 1
+    std::vector<std::vector<uint32_t> > choices; // choices of each page, indexed by page number - 1
+};
+
+#endif
@@ -0,0 +1,483 @@
+#include "StoryGraph.hpp"
+#include "Page.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+
+// stories smaller than this are searched by one thread.
+static const size_t PARALLEL_DEPTH_PAGES = 1 << 16;
+// frontiers smaller than this are expanded by one thread.
+static const size_t PARALLEL_FRONTIER = 1 << 12;
+// switch to bottom-up once the frontier has more than 1/ALPHA of the unexplored choices,
+// and back once it holds less than 1/BETA of the pages.
+static const size_t ALPHA = 14;
+static const size_t BETA = 24;
+
+const uint32_t StoryGraph::UNREACHABLE;
+
+/**
+ * @brief Construct a new StoryGraph::StoryGraph object
+ * 
+ */
+StoryGraph::StoryGraph(): own_offsets(1, 0), own_targets(), offsets(NULL), targets(NULL), page_num(0), ref_offsets(), ref_sources() {}
+
+/**
+ * @brief add the next page's choice to the forward arrays.
+ * 
+ * @param target page number the choice leads to.
+ */
+void StoryGraph::addChoice(uint32_t target){
+    if(own_targets.size() == UINT32_MAX){
+        findError("The story has too many choices!");
+    }
+    own_targets.push_back(target);
+}
+
+/**
+ * @brief close the current page of the forward arrays.
+ * 
+ */
+void StoryGraph::endPage(){
+    own_offsets.push_back(own_targets.size());
+    page_num = own_offsets.size() - 1;
+    offsets = own_offsets.data();
+    targets = own_targets.data();
+}
+
+/**
+ * @brief use forward arrays owned by someone else. They must stay alive as
+ * long as the graph, and every target must be a page of the story.
+ * 
+ * @param page_num number of pages.
+ * @param offsets index of each page's first choice, page_num + 1 entries.
+ * @param targets page number of each choice.
+ */
+void StoryGraph::attach(size_t page_num, const uint32_t * offsets, const uint32_t * targets){
+    this->page_num = page_num;
+    this->offsets = offsets;
+    this->targets = targets;
+    own_offsets.clear();
+    own_targets.clear();
+}
+
+/**
+ * @brief build the reverse arrays by counting sort, so the pages choosing a
+ * page come out in ascending order.
+ * 
+ */
+void StoryGraph::finish(){
+    size_t choice_num = getChoiceNum();
+    ref_offsets.assign(page_num + 1, 0);
+    for(size_t i = 0; i < choice_num; ++i){
+        ++ref_offsets[targets[i]];
+    }
+    for(size_t i = 1; i <= page_num; ++i){
+        ref_offsets[i] += ref_offsets[i - 1];
+    }
+    ref_sources.resize(choice_num);
+    std::vector<uint32_t> fill(ref_offsets.begin(), ref_offsets.end() - 1);
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        for(uint32_t i = offsets[pn - 1]; i < offsets[pn]; ++i){
+            ref_sources[fill[targets[i] - 1]++] = pn;
+        }
+    }
+}
+
+/**
+ * @brief get the number of pages.
+ * 
+ * @return size_t page number.
+ */
+size_t StoryGraph::getPageNum() const{
+    return page_num;
+}
+
+/**
+ * @brief get the number of choices over all pages.
+ * 
+ * @return size_t choice number.
+ */
+size_t StoryGraph::getChoiceNum() const{
+    return page_num == 0? 0 : offsets[page_num];
+}
+
+/**
+ * @brief get the page numbers the choices of a page lead to, in choice order.
+ * 
+ * @param pn page number.
+ * @return Span<uint32_t> view into the graph.
+ */
+Span<uint32_t> StoryGraph::getChoices(size_t pn) const{
+    return Span<uint32_t>(targets + offsets[pn - 1], offsets[pn] - offsets[pn - 1]);
+}
+
+/**
+ * @brief get the index of a page's first choice; the choices of page pn are
+ * getFirstChoice(pn), getFirstChoice(pn) + 1, ... in choice order.
+ * 
+ * @param pn page number.
+ * @return size_t choice index.
+ */
+size_t StoryGraph::getFirstChoice(size_t pn) const{
+    return offsets[pn - 1];
+}
+
+/**
+ * @brief get the pages having a choice leading to a page, once per choice.
+ * 
+ * @param pn page number.
+ * @return Span<uint32_t> view into the graph.
+ */
+Span<uint32_t> StoryGraph::getReferences(size_t pn) const{
+    return Span<uint32_t>(ref_sources.data() + ref_offsets[pn - 1], ref_offsets[pn] - ref_offsets[pn - 1]);
+}
+
+/**
+ * @brief find the strongly connected components reachable from page 1, with
+ * an iterative Tarjan search. Components are numbered from 1 in the order
+ * they complete, which is a reverse topological order: every choice leaving
+ * a component leads to a lower-numbered one.
+ * 
+ * @param component filled with the component of each page, indexed by page
+ * number; 0 for pages not reachable from page 1.
+ * @return size_t number of components.
+ */
+size_t StoryGraph::findComponents(std::vector<uint32_t> & component) const{
+    std::vector<uint32_t> index(page_num + 1, 0), low(page_num + 1, 0);
+    std::vector<uint32_t> open_pages; // pages visited but not yet in a component
+    std::vector<std::pair<uint32_t, uint32_t> > calls; // (page num, next choice)
+    uint32_t visited = 0, component_num = 0;
+    component.assign(page_num + 1, 0);
+
+    if(page_num == 0){
+        return 0;
+    }
+    index[1] = low[1] = ++visited;
+    open_pages.push_back(1);
+    calls.push_back(std::pair<uint32_t, uint32_t>(1, 0));
+    while(!calls.empty()){
+        uint32_t pn = calls.back().first;
+        Span<uint32_t> options = getChoices(pn);
+        if(calls.back().second < options.size()){
+            uint32_t next = options[calls.back().second++];
+            if(index[next] == 0){
+                index[next] = low[next] = ++visited;
+                open_pages.push_back(next);
+                calls.push_back(std::pair<uint32_t, uint32_t>(next, 0));
+            }
+            else if(component[next] == 0){ // still open: part of the current path's components
+                low[pn] = std::min(low[pn], index[next]);
+            }
+            continue;
+        }
+        calls.pop_back();
+        if(low[pn] == index[pn]){
+            ++component_num;
+            uint32_t member;
+            do{
+                member = open_pages.back();
+                open_pages.pop_back();
+                component[member] = component_num;
+            }while(member != pn);
+        }
+        if(!calls.empty()){
+            uint32_t parent = calls.back().first;
+            low[parent] = std::min(low[parent], low[pn]);
+        }
+    }
+    return component_num;
+}
+
+/**
+ * @brief find the immediate dominator of every page reachable from page 1:
+ * the last page before it that every route from page 1 to it goes through.
+ * This is the Lengauer-Tarjan algorithm with path compression, O(E log V):
+ * pages are numbered in depth-first order, the semidominators are found in
+ * reverse order through the referrers of each page, and the dominators are
+ * then fixed up in order. The search and the path compression both use
+ * explicit stacks, so long chains of pages don't overflow the call stack.
+ * 
+ * @param idom filled with the immediate dominator of each page, indexed by
+ * page number; 0 for page 1 and for pages not reachable from page 1.
+ */
+void StoryGraph::findDominators(std::vector<uint32_t> & idom) const{
+    idom.assign(page_num + 1, 0);
+    if(page_num == 0){
+        return;
+    }
+    // depth-first numbering from 1; vertex[n] is the page numbered n.
+    std::vector<uint32_t> number(page_num + 1, 0), vertex(1, 0), parent(page_num + 1, 0);
+    std::vector<std::pair<uint32_t, uint32_t> > calls; // (page num, next choice)
+    number[1] = 1;
+    vertex.push_back(1);
+    calls.push_back(std::pair<uint32_t, uint32_t>(1, 0));
+    while(!calls.empty()){
+        uint32_t pn = calls.back().first;
+        Span<uint32_t> options = getChoices(pn);
+        if(calls.back().second == options.size()){
+            calls.pop_back();
+            continue;
+        }
+        uint32_t next = options[calls.back().second++];
+        if(number[next] == 0){
+            number[next] = vertex.size();
+            vertex.push_back(next);
+            parent[number[next]] = number[pn];
+            calls.push_back(std::pair<uint32_t, uint32_t>(next, 0));
+        }
+    }
+
+    // everything below is indexed by depth-first number.
+    size_t n = vertex.size() - 1;
+    std::vector<uint32_t> semi(n + 1), label(n + 1), ancestor(n + 1, 0), dom(n + 1, 0);
+    std::vector<std::vector<uint32_t> > bucket(n + 1);
+    std::vector<uint32_t> path;
+    for(size_t v = 1; v <= n; ++v){
+        semi[v] = label[v] = v;
+    }
+    // the page of least semidominator on v's path in the forest linked so far.
+    auto eval = [&](uint32_t v) -> uint32_t {
+        if(ancestor[v] == 0){
+            return v;
+        }
+        for(uint32_t x = v; ancestor[ancestor[x]] != 0; x = ancestor[x]){
+            path.push_back(x);
+        }
+        while(!path.empty()){ // compress from the top of the path down
+            uint32_t x = path.back();
+            path.pop_back();
+            if(semi[label[ancestor[x]]] < semi[label[x]]){
+                label[x] = label[ancestor[x]];
+            }
+            ancestor[x] = ancestor[ancestor[x]];
+        }
+        return label[v];
+    };
+    for(size_t w = n; w >= 2; --w){
+        Span<uint32_t> sources = getReferences(vertex[w]);
+        for(size_t i = 0; i < sources.size(); ++i){
+            uint32_t v = number[sources[i]];
+            if(v == 0){
+                continue; // not reachable from page 1
+            }
+            uint32_t u = eval(v);
+            if(semi[u] < semi[w]){
+                semi[w] = semi[u];
+            }
+        }
+        bucket[semi[w]].push_back(w);
+        ancestor[w] = parent[w];
+        std::vector<uint32_t> & waiting = bucket[parent[w]];
+        for(size_t i = 0; i < waiting.size(); ++i){
+            uint32_t v = waiting[i];
+            uint32_t u = eval(v);
+            dom[v] = semi[u] < semi[v]? u : parent[w];
+        }
+        waiting.clear();
+    }
+    for(size_t w = 2; w <= n; ++w){
+        if(dom[w] != semi[w]){
+            dom[w] = dom[dom[w]];
+        }
+        idom[vertex[w]] = vertex[dom[w]];
+    }
+}
+
+/**
+ * @brief find the pages from which some WIN page can be reached, with one
+ * search backwards from all WIN pages at once over the reverse arrays. Every
+ * page and every choice is looked at once at most.
+ * 
+ * @param is_win whether each page is a WIN page, indexed by page number.
+ * @param can_win filled with whether a WIN page can be reached from each
+ * page, indexed by page number; a WIN page reaches itself.
+ */
+void StoryGraph::findWinnable(const std::vector<bool> & is_win, std::vector<bool> & can_win) const{
+    can_win.assign(page_num + 1, false);
+    std::vector<uint32_t> queue;
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        if(is_win[pn]){
+            can_win[pn] = true;
+            queue.push_back(pn);
+        }
+    }
+    for(size_t head = 0; head < queue.size(); ++head){
+        Span<uint32_t> sources = getReferences(queue[head]);
+        for(size_t i = 0; i < sources.size(); ++i){
+            if(!can_win[sources[i]]){
+                can_win[sources[i]] = true;
+                queue.push_back(sources[i]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief find the number of choices from page 1 to every page. Small stories
+ * are searched with a plain queue. Large ones with several threads are
+ * searched level by level: a level is expanded top-down from the list of
+ * frontier pages while the frontier is small, and bottom-up, with every
+ * unvisited page checking its referrers against a frontier bitmap, once the
+ * frontier's choices are a large share of those left to explore.
+ * 
+ * @param depth filled with the depth of each page, indexed by page number;
+ * UNREACHABLE for pages not reachable from page 1.
+ * @param thread_num number of threads searching.
+ */
+void StoryGraph::findDepths(std::vector<uint32_t> & depth, size_t thread_num) const{
+    depth.assign(page_num + 1, UNREACHABLE);
+    if(page_num == 0){
+        return;
+    }
+    depth[1] = 0;
+    if(thread_num <= 1 || page_num < PARALLEL_DEPTH_PAGES){
+        std::vector<uint32_t> waiting_do(1, 1);
+        waiting_do.reserve(page_num);
+        for(size_t head = 0; head < waiting_do.size(); ++head){
+            uint32_t pn = waiting_do[head];
+            Span<uint32_t> options = getChoices(pn);
+            for(size_t i = 0; i < options.size(); ++i){
+                if(depth[options[i]] == UNREACHABLE){ // if not yet visited
+                    depth[options[i]] = depth[pn] + 1;
+                    waiting_do.push_back(options[i]);
+                }
+            }
+        }
+        return;
+    }
+
+    size_t words = page_num / 64 + 1;
+    std::vector<std::atomic<uint64_t> > visited(words);
+    for(size_t i = 0; i < words; ++i){
+        visited[i].store(0);
+    }
+    visited[0].store(2); // page 1
+    std::vector<uint32_t> frontier(1, 1);
+    std::vector<uint64_t> frontier_bits, next_bits;
+    size_t frontier_size = 1, frontier_edges = getChoices(1).size();
+    size_t unexplored_edges = getChoiceNum() - frontier_edges;
+    bool bottom_up = false;
+
+    for(uint32_t level = 0; frontier_size > 0; ++level){
+        if(!bottom_up && frontier_edges > unexplored_edges / ALPHA){
+            frontier_bits.assign(words, 0);
+            for(size_t i = 0; i < frontier.size(); ++i){
+                frontier_bits[frontier[i] >> 6] |= (uint64_t)1 << (frontier[i] & 63);
+            }
+            bottom_up = true;
+        }
+        else if(bottom_up && frontier_size < page_num / BETA){
+            frontier.clear();
+            for(size_t w = 0; w < words; ++w){
+                for(uint64_t bits = frontier_bits[w]; bits != 0; bits &= bits - 1){
+                    frontier.push_back(w * 64 + __builtin_ctzll(bits));
+                }
+            }
+            bottom_up = false;
+        }
+
+        if(bottom_up){
+            next_bits.assign(words, 0);
+            frontier_size = expandBottomUp(frontier_bits, next_bits, depth, level, visited, thread_num, frontier_edges);
+            frontier_bits.swap(next_bits);
+        }
+        else{
+            expandTopDown(frontier, depth, level, visited, thread_num, frontier_edges);
+            frontier_size = frontier.size();
+        }
+        unexplored_edges -= std::min(unexplored_edges, frontier_edges);
+    }
+}
+
+/**
+ * @brief one level of the parallel search: follow the choices of the frontier
+ * pages, claiming each newly found page in the visited bitmap.
+ * 
+ * @param frontier pages at depth level; replaced by the pages at level + 1.
+ * @param depth page depths.
+ * @param level depth of the frontier.
+ * @param visited bitmap of the pages with a depth.
+ * @param thread_num number of threads searching.
+ * @param next_edges set to the number of choices of the new frontier.
+ */
+void StoryGraph::expandTopDown(std::vector<uint32_t> & frontier, std::vector<uint32_t> & depth, uint32_t level,
+                               std::vector<std::atomic<uint64_t> > & visited, size_t thread_num, size_t & next_edges) const{
+    size_t chunk_num = frontier.size() < PARALLEL_FRONTIER? 1 : thread_num * 4;
+    std::vector<std::vector<uint32_t> > found(chunk_num);
+    std::vector<size_t> edges(chunk_num, 0);
+    parallelFor(chunk_num, chunk_num == 1? 1 : thread_num, [&](size_t k){
+        size_t begin = frontier.size() * k / chunk_num, end = frontier.size() * (k + 1) / chunk_num;
+        for(size_t i = begin; i < end; ++i){
+            Span<uint32_t> options = getChoices(frontier[i]);
+            for(size_t j = 0; j < options.size(); ++j){
+                uint32_t next = options[j];
+                uint64_t bit = (uint64_t)1 << (next & 63);
+                if((visited[next >> 6].load(std::memory_order_relaxed) & bit) != 0
+                   || (visited[next >> 6].fetch_or(bit) & bit) != 0){
+                    continue;
+                }
+                depth[next] = level + 1;
+                found[k].push_back(next);
+                edges[k] += getChoices(next).size();
+            }
+        }
+    });
+    frontier.clear();
+    next_edges = 0;
+    for(size_t k = 0; k < chunk_num; ++k){
+        frontier.insert(frontier.end(), found[k].begin(), found[k].end());
+        next_edges += edges[k];
+    }
+}
+
+/**
+ * @brief one level of the parallel search: every unvisited page looks for a
+ * page choosing it in the frontier. Each bitmap word is handled by one
+ * thread, so no page is claimed twice.
+ * 
+ * @param frontier bitmap of the pages at depth level.
+ * @param next bitmap of the pages at level + 1, all clear on entry.
+ * @param depth page depths.
+ * @param level depth of the frontier.
+ * @param visited bitmap of the pages with a depth.
+ * @param thread_num number of threads searching.
+ * @param next_edges set to the number of choices of the new frontier.
+ * @return size_t the number of pages at level + 1.
+ */
+size_t StoryGraph::expandBottomUp(const std::vector<uint64_t> & frontier, std::vector<uint64_t> & next, std::vector<uint32_t> & depth,
+                                  uint32_t level, std::vector<std::atomic<uint64_t> > & visited, size_t thread_num, size_t & next_edges) const{
+    size_t words = frontier.size(), chunk_num = thread_num * 4;
+    std::vector<size_t> counts(chunk_num, 0), edges(chunk_num, 0);
+    parallelFor(chunk_num, thread_num, [&](size_t k){
+        for(size_t w = words * k / chunk_num; w < words * (k + 1) / chunk_num; ++w){
+            uint64_t unvisited = ~visited[w].load(std::memory_order_relaxed);
+            if(w == 0){
+                unvisited &= ~(uint64_t)1; // there is no page 0
+            }
+            if(w == words - 1 && (page_num + 1) % 64 != 0){
+                unvisited &= ((uint64_t)1 << ((page_num + 1) % 64)) - 1;
+            }
+            for(; unvisited != 0; unvisited &= unvisited - 1){
+                uint32_t pn = w * 64 + __builtin_ctzll(unvisited);
+                Span<uint32_t> refs = getReferences(pn);
+                for(size_t i = 0; i < refs.size(); ++i){
+                    if(frontier[refs[i] >> 6] & ((uint64_t)1 << (refs[i] & 63))){
+                        depth[pn] = level + 1;
+                        next[w] |= (uint64_t)1 << (pn & 63);
+                        ++counts[k];
+                        edges[k] += getChoices(pn).size();
+                        break;
+                    }
+                }
+            }
+            visited[w].fetch_or(next[w]);
+        }
+    });
+    size_t count = 0;
+    next_edges = 0;
+    for(size_t k = 0; k < chunk_num; ++k){
+        count += counts[k];
+        next_edges += edges[k];
+    }
+    return count;
+}
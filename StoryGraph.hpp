@@ -0,0 +1,99 @@
+#ifndef STORY_GRAPH_HPP
+#define STORY_GRAPH_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// non-owning view of a contiguous array.
+template<typename T>
+class Span{
+public:
+    Span(): ptr(NULL), len(0) {}
+    Span(const T * data, size_t size): ptr(data), len(size) {}
+
+    const T * begin() const { return ptr; }
+    const T * end() const { return ptr + len; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const T & operator[](size_t i) const { return ptr[i]; }
+
+private:
+    const T * ptr;
+    size_t len;
+};
+
+// the story's choices as a graph in compressed-sparse-row form. Pages are
+// numbered from 1 as in the story; choice i of page pn is
+// targets[offsets[pn - 1] + i], and the pages choosing pn are listed the
+// same way in the reverse arrays, in ascending page order.
+class StoryGraph{
+public:
+    // default constructor
+    StoryGraph();
+
+    // add the next page's choice to the forward arrays.
+    void addChoice(uint32_t target);
+
+    // close the current page of the forward arrays.
+    void endPage();
+
+    // use forward arrays owned by someone else, e.g. a mapped compiled story.
+    void attach(size_t page_num, const uint32_t * offsets, const uint32_t * targets);
+
+    // build the reverse arrays once all pages are added or attached.
+    void finish();
+
+    // get the number of pages.
+    size_t getPageNum() const;
+
+    // get the number of choices over all pages.
+    size_t getChoiceNum() const;
+
+    // get the page numbers the choices of a page lead to.
+    Span<uint32_t> getChoices(size_t pn) const;
+
+    // get the index of a page's first choice.
+    size_t getFirstChoice(size_t pn) const;
+
+    // get the pages having a choice leading to a page.
+    Span<uint32_t> getReferences(size_t pn) const;
+
+    // find the strongly connected components reachable from page 1.
+    size_t findComponents(std::vector<uint32_t> & component) const;
+
+    // find the immediate dominator of every page reachable from page 1.
+    void findDominators(std::vector<uint32_t> & idom) const;
+
+    // find the pages from which some WIN page can be reached.
+    void findWinnable(const std::vector<bool> & is_win, std::vector<bool> & can_win) const;
+
+    // find the number of choices from page 1 to every page.
+    void findDepths(std::vector<uint32_t> & depth, size_t thread_num) const;
+
+    // depth of a page not reachable from page 1.
+    static const uint32_t UNREACHABLE = UINT32_MAX;
+
+private:
+    StoryGraph(const StoryGraph &);
+    StoryGraph & operator=(const StoryGraph &);
+
+    // one level of the parallel search, following the frontier's choices.
+    void expandTopDown(std::vector<uint32_t> & frontier, std::vector<uint32_t> & depth, uint32_t level,
+                       std::vector<std::atomic<uint64_t> > & visited, size_t thread_num, size_t & next_edges) const;
+
+    // one level of the parallel search, unvisited pages looking for a referrer in the frontier.
+    size_t expandBottomUp(const std::vector<uint64_t> & frontier, std::vector<uint64_t> & next, std::vector<uint32_t> & depth,
+                          uint32_t level, std::vector<std::atomic<uint64_t> > & visited, size_t thread_num, size_t & next_edges) const;
+
+    std::vector<uint32_t> own_offsets; // forward arrays, when built here
+    std::vector<uint32_t> own_targets;
+    const uint32_t * offsets; // forward arrays in use
+    const uint32_t * targets;
+    size_t page_num;
+    std::vector<uint32_t> ref_offsets; // reverse arrays
+    std::vector<uint32_t> ref_sources;
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "StoryPages.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Construct a new StoryPages::StoryPages object
+ * 
+ */
+StoryPages::StoryPages(): own_types(), own_labels(), own_texts(), own_arena(), text_dir(), text_starts(), rendered_pages(), types(NULL), labels(NULL), texts(NULL), arena(NULL), arena_size(0), page_num(0), choice_num(0) {}
+
+/**
+ * @brief Destroy the StoryPages::StoryPages object
+ * 
+ */
+StoryPages::~StoryPages(){
+    for(size_t i = 0; i < rendered_pages.size(); ++i){
+        delete rendered_pages[i].load();
+    }
+}
+
+/**
+ * @brief drop every rendered page and make one empty slot per page.
+ * 
+ */
+void StoryPages::clearRendered(){
+    for(size_t i = 0; i < rendered_pages.size(); ++i){
+        delete rendered_pages[i].load();
+    }
+    std::vector<std::atomic<std::string *> > slots(page_num);
+    for(size_t i = 0; i < page_num; ++i){
+        slots[i].store(NULL);
+    }
+    rendered_pages.swap(slots);
+}
+
+/**
+ * @brief move parsed pages into the arena. The arena is sized before anything
+ * is copied, and each page is released once copied, so the story is never
+ * held twice over.
+ * 
+ * @param pages all valid pages in the story, in page number order; emptied.
+ */
+void StoryPages::build(std::vector<Page> & pages){
+    size_t label_size = 0, text_size = 0;
+    page_num = pages.size();
+    choice_num = 0;
+    for(size_t i = 0; i < page_num; ++i){
+        label_size += pages[i].getLabels().size();
+        text_size += pages[i].getText().size();
+        choice_num += pages[i].getChoices().size();
+    }
+    own_types.resize(page_num);
+    own_labels.resize(choice_num + 1);
+    own_texts.resize(page_num + 1);
+    own_arena.resize(label_size + text_size);
+
+    size_t choice = 0, label_end = 0, text_end = label_size;
+    own_labels[0] = 0;
+    for(size_t i = 0; i < page_num; ++i){
+        own_types[i] = pages[i].getType();
+        const std::vector<uint64_t> & offsets = pages[i].getLabelOffsets();
+        for(size_t j = 1; j < offsets.size(); ++j){
+            own_labels[++choice] = label_end + offsets[j];
+        }
+        const std::string & label = pages[i].getLabels();
+        memcpy(own_arena.data() + label_end, label.data(), label.size());
+        label_end += label.size();
+
+        const std::string & text = pages[i].getText();
+        own_texts[i] = text_end;
+        memcpy(own_arena.data() + text_end, text.data(), text.size());
+        text_end += text.size();
+        pages[i] = Page();
+    }
+    own_texts[page_num] = text_end;
+    pages.clear();
+
+    types = own_types.data();
+    labels = own_labels.data();
+    texts = own_texts.data();
+    arena = own_arena.data();
+    arena_size = own_arena.size();
+    clearRendered();
+}
+
+/**
+ * @brief move pages read without their text into the arena, which then holds
+ * only the labels; each text is read from its page file once it is needed.
+ * 
+ * @param pages all valid pages in the story, in page number order; emptied.
+ * @param text_dir the story directory the pages were read from.
+ */
+void StoryPages::build(std::vector<Page> & pages, const std::string & text_dir){
+    text_starts.resize(pages.size());
+    for(size_t i = 0; i < pages.size(); ++i){
+        text_starts[i] = pages[i].getTextStart();
+    }
+    build(pages);
+    this->text_dir = text_dir;
+    own_texts.clear();
+    texts = NULL;
+}
+
+/**
+ * @brief check whether the texts are read on demand.
+ * 
+ * @return true the texts are read from the page files.
+ * @return false the texts are in the arena.
+ */
+bool StoryPages::isLazy() const{
+    return !text_dir.empty();
+}
+
+/**
+ * @brief use arrays owned by someone else. They must stay alive as long as
+ * these pages, and every offset must lie inside the arena.
+ * 
+ * @param page_num number of pages.
+ * @param choice_num number of choices over all pages.
+ * @param types PageType of each page.
+ * @param labels arena offset of each label, choice_num + 1 entries.
+ * @param texts arena offset of each text, page_num + 1 entries.
+ * @param arena the labels and texts.
+ * @param arena_size arena length.
+ */
+void StoryPages::attach(size_t page_num, size_t choice_num, const uint8_t * types, const uint64_t * labels,
+                        const uint64_t * texts, const char * arena, size_t arena_size){
+    this->page_num = page_num;
+    this->choice_num = choice_num;
+    this->types = types;
+    this->labels = labels;
+    this->texts = texts;
+    this->arena = arena;
+    this->arena_size = arena_size;
+    own_types.clear();
+    own_labels.clear();
+    own_texts.clear();
+    own_arena.clear();
+    text_dir.clear();
+    text_starts.clear();
+    clearRendered();
+}
+
+/**
+ * @brief get the number of pages.
+ * 
+ * @return size_t page number.
+ */
+size_t StoryPages::getPageNum() const{
+    return page_num;
+}
+
+/**
+ * @brief get the number of choices over all pages.
+ * 
+ * @return size_t choice number.
+ */
+size_t StoryPages::getChoiceNum() const{
+    return choice_num;
+}
+
+/**
+ * @brief get the page type.
+ * 
+ * @param pn page number.
+ * @return PageType PAGE_CHOICE, PAGE_WIN, PAGE_LOSE
+ */
+PageType StoryPages::getType(size_t pn) const{
+    return (PageType)types[pn - 1];
+}
+
+/**
+ * @brief get a page exactly as Page::printPage prints it. The page is rendered
+ * the first time, reading its text from the page file when the texts are
+ * read on demand, and kept for later visits. Threads rendering the same page
+ * at once each build it, and the first to finish publishes its copy.
+ * 
+ * @param pn page number.
+ * @param first_choice index of the page's first choice in the story graph.
+ * @param choice_num number of choices of the page.
+ * @return const std::string& the rendered page.
+ */
+const std::string & StoryPages::renderPage(size_t pn, size_t first_choice, size_t choice_num) const{
+    std::string * page = rendered_pages[pn - 1].load(std::memory_order_acquire);
+    if(page != NULL){
+        return *page;
+    }
+    std::string * rendered = new std::string();
+    if(!isLazy()){
+        ::renderPage(getType(pn), arena + texts[pn - 1], texts[pn] - texts[pn - 1], arena, labels + first_choice,
+                     choice_num, *rendered);
+    }
+    else{
+        std::string text;
+        std::string file_name = text_dir + "/page" + std::to_string(pn) + ".txt";
+        try{
+            Page::readText(file_name.c_str(), text_starts[pn - 1], text);
+        }
+        catch(StoryError & e){
+            findError(e.what());
+        }
+        ::renderPage(getType(pn), text.data(), text.size(), arena, labels + first_choice, choice_num, *rendered);
+    }
+    if(rendered_pages[pn - 1].compare_exchange_strong(page, rendered, std::memory_order_acq_rel)){
+        return *rendered;
+    }
+    delete rendered; // page is the copy published meanwhile
+    return *page;
+}
+
+/**
+ * @brief get the label of a choice.
+ * 
+ * @param choice index of the choice in the story graph.
+ * @return Span<char> the choice description.
+ */
+Span<char> StoryPages::getLabel(size_t choice) const{
+    return Span<char>(arena + labels[choice], labels[choice + 1] - labels[choice]);
+}
+
+/**
+ * @brief print the page exactly as Page::printPage does.
+ * 
+ * @param pn page number.
+ * @param first_choice index of the page's first choice in the story graph.
+ * @param choice_num number of choices of the page.
+ * @param out the output.
+ */
+void StoryPages::printPage(size_t pn, size_t first_choice, size_t choice_num, OutputBuffer & out) const{
+    out.write(renderPage(pn, first_choice, choice_num));
+}
+
+/**
+ * @brief get the type of each page.
+ * 
+ * @return const uint8_t* page number entries.
+ */
+const uint8_t * StoryPages::getTypes() const{
+    return types;
+}
+
+/**
+ * @brief get the arena offset of each label.
+ * 
+ * @return const uint64_t* choice number + 1 entries.
+ */
+const uint64_t * StoryPages::getLabelOffsets() const{
+    return labels;
+}
+
+/**
+ * @brief get the arena offset of each text.
+ * 
+ * @return const uint64_t* page number + 1 entries; NULL when the texts are
+ * read on demand.
+ */
+const uint64_t * StoryPages::getTextOffsets() const{
+    return texts;
+}
+
+/**
+ * @brief get the arena.
+ * 
+ * @return Span<char> all labels, then all texts unless they are read on demand.
+ */
+Span<char> StoryPages::getArena() const{
+    return Span<char>(arena, arena_size);
+}
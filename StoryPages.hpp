@@ -0,0 +1,94 @@
+#ifndef STORY_PAGES_HPP
+#define STORY_PAGES_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "Output.hpp"
+#include "Page.hpp"
+#include "StoryGraph.hpp"
+
+// the printable side of a story: the type of every page, and the choice
+// labels and page texts in one arena, all labels first, then all texts. A
+// label or text is a span between two consecutive offsets into the arena.
+// The choices themselves live in the StoryGraph, choice i of the story
+// having label i. Pages read without their text keep only where it starts
+// in the page file, and each text is read the first time it is needed.
+// A page is rendered once, the first time it is printed; that is the only
+// change after loading, and it is safe from any number of threads.
+class StoryPages{
+public:
+    // default constructor
+    StoryPages();
+    // destructor
+    ~StoryPages();
+
+    // move parsed pages, in page number order, into the arena.
+    void build(std::vector<Page> & pages);
+
+    // move pages read without their text, from the files of a story directory.
+    void build(std::vector<Page> & pages, const std::string & text_dir);
+
+    // check whether the texts are read on demand.
+    bool isLazy() const;
+
+    // use arrays owned by someone else, e.g. a mapped compiled story.
+    void attach(size_t page_num, size_t choice_num, const uint8_t * types, const uint64_t * labels,
+                const uint64_t * texts, const char * arena, size_t arena_size);
+
+    // get the number of pages.
+    size_t getPageNum() const;
+
+    // get the number of choices over all pages.
+    size_t getChoiceNum() const;
+
+    // get the page type.
+    PageType getType(size_t pn) const;
+
+
+    // get the label of a choice, by its index in the story graph.
+    Span<char> getLabel(size_t choice) const;
+
+    // get a page as printed; its choices are first_choice, first_choice + 1, ...
+    const std::string & renderPage(size_t pn, size_t first_choice, size_t choice_num) const;
+
+    // print a page whose choices are first_choice, first_choice + 1, ...
+    void printPage(size_t pn, size_t first_choice, size_t choice_num, OutputBuffer & out) const;
+
+    // get the type of each page.
+    const uint8_t * getTypes() const;
+
+    // get the arena offset of each label, choice number + 1 entries.
+    const uint64_t * getLabelOffsets() const;
+
+    // get the arena offset of each text, page number + 1 entries.
+    const uint64_t * getTextOffsets() const;
+
+    // get the arena.
+    Span<char> getArena() const;
+
+private:
+    StoryPages(const StoryPages &);
+    StoryPages & operator=(const StoryPages &);
+
+    std::vector<uint8_t> own_types; // arrays, when built here
+    std::vector<uint64_t> own_labels;
+    std::vector<uint64_t> own_texts;
+    std::vector<char> own_arena;
+    std::string text_dir; // story directory of the texts read on demand
+    std::vector<uint64_t> text_starts; // file offset of each text read on demand
+    mutable std::vector<std::atomic<std::string *> > rendered_pages; // pages printed so far, by page number - 1
+
+    // prepare the rendered page slots.
+    void clearRendered();
+    const uint8_t * types; // arrays in use
+    const uint64_t * labels;
+    const uint64_t * texts;
+    const char * arena;
+    size_t arena_size;
+    size_t page_num;
+    size_t choice_num;
+};
+
+#endif
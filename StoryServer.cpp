@@ -0,0 +1,339 @@
+#include "StoryServer.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// events handled per epoll_wait.
+static const int EVENT_NUM = 64;
+// bytes read from a session at once.
+static const size_t READ_SIZE = 4096;
+// bytes read from one session per event, so a fast sender can't starve the
+// others; level-triggered epoll brings the loop back for the rest.
+static const size_t READ_LIMIT = 16 * READ_SIZE;
+// unsent output a session may hold; past it the session's input waits until
+// the reader takes its answers, so a reader that never reads can't make the
+// server grow without end.
+static const size_t OUT_LIMIT = 64 * 1024;
+// longest input line kept; a session sending a longer one is dropped, so a
+// reader that never sends a newline can't make the server grow without end.
+static const size_t LINE_LIMIT = 64 * 1024;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief ask the event loop to stop.
+ * 
+ * @param sig the signal.
+ */
+static void requestStop(int sig){
+    (void)sig;
+    stop_requested = 1;
+}
+
+/**
+ * @brief Construct a new StoryServer::StoryServer object
+ * 
+ * @param story the loaded story, shared by every session.
+ */
+StoryServer::StoryServer(const Story & story): story(story), socket_path(), listen_fd(-1), epoll_fd(-1), sessions() {}
+
+/**
+ * @brief Construct a new StoryServer::Session object, on page 1 with the
+ * page still to be sent.
+ * 
+ * @param story the story read.
+ */
+StoryServer::Session::Session(const Story & story): reader(story), over(false), events(EPOLLIN), in(), out(reader.renderCurrent()) {}
+
+/**
+ * @brief Destroy the StoryServer::StoryServer object, closing every session
+ * and removing the socket.
+ * 
+ */
+StoryServer::~StoryServer(){
+    for(size_t fd = 0; fd < sessions.size(); ++fd){
+        if(sessions[fd] != NULL){
+            close(fd);
+            delete sessions[fd];
+        }
+    }
+    if(epoll_fd >= 0){
+        close(epoll_fd);
+    }
+    if(listen_fd >= 0){
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+/**
+ * @brief bind the socket and listen on it. A stale socket left at the path
+ * is replaced; any other file there is an error.
+ * 
+ * @param socket_path file system path of the socket.
+ */
+void StoryServer::listen(const std::string & socket_path){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)){
+        findError("The socket path is too long!");
+    }
+    memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+
+    struct stat st;
+    if(lstat(socket_path.c_str(), &st) == 0){
+        if(!S_ISSOCK(st.st_mode)){
+            findError("The socket path is taken by another file!");
+        }
+        unlink(socket_path.c_str());
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        findError("The socket cannot be bound!");
+    }
+    this->socket_path = socket_path;
+    if(::listen(listen_fd, SOMAXCONN) != 0){
+        findError("The socket cannot be listened on!");
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0){
+        findError("The event loop cannot be created!");
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) != 0){
+        findError("The event loop cannot watch the socket!");
+    }
+}
+
+/**
+ * @brief serve sessions until SIGINT or SIGTERM. Everything runs on this
+ * thread; a session only costs its ReaderSession and its unsent bytes.
+ * 
+ */
+void StoryServer::run(){
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop; // no SA_RESTART, so epoll_wait returns
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct epoll_event events[EVENT_NUM];
+    while(!stop_requested){
+        int n = epoll_wait(epoll_fd, events, EVENT_NUM, -1);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            findError("The event loop failed!");
+        }
+        for(int i = 0; i < n; ++i){
+            int fd = events[i].data.fd;
+            if(fd == listen_fd){
+                acceptSessions();
+                continue;
+            }
+            if(sessions[fd] == NULL){
+                continue; // closed earlier in this batch
+            }
+            if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+                readSession(fd);
+            }
+            if(sessions[fd] != NULL && (events[i].events & EPOLLOUT)){
+                writeSession(fd);
+            }
+        }
+    }
+}
+
+/**
+ * @brief accept every pending connection and send each its first page. A
+ * connection the event loop can't watch is closed at once, since it would
+ * never be served.
+ * 
+ */
+void StoryServer::acceptSessions(){
+    while(true){
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0){
+            return; // EAGAIN, or a connection that went away meanwhile
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0){
+            close(fd);
+            continue;
+        }
+        if((size_t)fd >= sessions.size()){
+            sessions.resize(fd + 1, NULL);
+        }
+        sessions[fd] = new Session(story);
+        writeSession(fd);
+    }
+}
+
+/**
+ * @brief read what a session sent and answer each complete line as it
+ * comes. At the end of its input, an unterminated last line is answered
+ * too, as getline returns it. A call reads at most READ_LIMIT bytes, and
+ * none while OUT_LIMIT bytes of answers wait to be sent. A session whose
+ * unanswered line grows past LINE_LIMIT is closed.
+ * 
+ * @param fd the session's socket.
+ */
+void StoryServer::readSession(int fd){
+    Session & session = *sessions[fd];
+    char buffer[READ_SIZE];
+    bool eof = false;
+    size_t total = 0;
+    while(total < READ_LIMIT && (session.over || session.out.size() < OUT_LIMIT)){
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if(n > 0){
+            total += n;
+            if(!session.over){
+                session.in.append(buffer, n);
+                answerLines(session);
+                if(!session.over && session.out.size() < OUT_LIMIT && session.in.size() > LINE_LIMIT){
+                    closeSession(fd);
+                    return;
+                }
+            }
+            continue;
+        }
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            break;
+        }
+        eof = true; // end of input, or the connection broke
+        break;
+    }
+
+    if(eof){
+        if(!session.over && !session.in.empty()){
+            answer(session, session.in);
+        }
+        session.over = true;
+    }
+    if(session.over){
+        session.in.clear();
+    }
+    writeSession(fd);
+}
+
+/**
+ * @brief answer each complete line a session sent, keeping the unfinished
+ * last one. Lines past OUT_LIMIT bytes of unsent answers are kept too, and
+ * answered once the reader takes some.
+ * 
+ * @param session the reader.
+ */
+void StoryServer::answerLines(Session & session){
+    size_t start = 0, newline;
+    while(!session.over && session.out.size() < OUT_LIMIT && (newline = session.in.find('\n', start)) != std::string::npos){
+        answer(session, session.in.substr(start, newline - start));
+        start = newline + 1;
+    }
+    session.in.erase(0, start);
+}
+
+/**
+ * @brief answer one line of input, as readCYOA does.
+ * 
+ * @param session the reader.
+ * @param line the input line, without its newline.
+ */
+void StoryServer::answer(Session & session, const std::string & line){
+    int choice_num = session.reader.isValidChoice(line);
+    if(!choice_num){
+        session.out += "That is not a valid choice, please try again\n";
+        return;
+    }
+    session.reader.setCurrent(choice_num);
+    session.out += session.reader.renderCurrent();
+    if(session.reader.isOver()){
+        session.over = true;
+    }
+}
+
+/**
+ * @brief write a session's pending output, answering the lines held back
+ * while it was full. What the socket does not take now waits for EPOLLOUT,
+ * and the session's input waits with it while OUT_LIMIT bytes are unsent; a
+ * session that is over is closed once all is written.
+ * 
+ * @param fd the session's socket.
+ */
+void StoryServer::writeSession(int fd){
+    Session & session = *sessions[fd];
+    while(true){
+        size_t sent = 0;
+        while(sent < session.out.size()){
+            ssize_t n = send(fd, session.out.data() + sent, session.out.size() - sent, MSG_NOSIGNAL);
+            if(n > 0){
+                sent += n;
+                continue;
+            }
+            if(n < 0 && errno == EINTR){
+                continue;
+            }
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+                break;
+            }
+            closeSession(fd); // the reader went away
+            return;
+        }
+        session.out.erase(0, sent);
+        if(session.over || session.out.size() >= OUT_LIMIT || session.in.find('\n') == std::string::npos){
+            break;
+        }
+        answerLines(session);
+        if(session.over){
+            session.in.clear();
+        }
+    }
+    if(session.over && session.out.empty()){
+        closeSession(fd);
+        return;
+    }
+
+    uint32_t events = (session.over || session.out.size() < OUT_LIMIT? EPOLLIN : 0) | (session.out.empty()? 0 : EPOLLOUT);
+    if(events != session.events){
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.fd = fd;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0){
+            closeSession(fd); // it would wait for EPOLLOUT forever
+            return;
+        }
+        session.events = events;
+    }
+}
+
+/**
+ * @brief close a session.
+ * 
+ * @param fd the session's socket.
+ */
+void StoryServer::closeSession(int fd){
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    delete sessions[fd];
+    sessions[fd] = NULL;
+}
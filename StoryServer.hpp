@@ -0,0 +1,66 @@
+#ifndef STORY_SERVER_HPP
+#define STORY_SERVER_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CYOA.hpp"
+
+// serves reading sessions of one loaded story over a Unix-domain socket.
+// Each connection is one reader: it gets page 1, sends one choice per line,
+// and gets exactly what readCYOA would print, until the story ends or the
+// reader closes its side.
+class StoryServer{
+public:
+    // constructor: the story must outlive the server.
+    StoryServer(const Story & story);
+    // destructor
+    ~StoryServer();
+
+    // bind the socket and listen on it.
+    void listen(const std::string & socket_path);
+
+    // serve sessions until SIGINT or SIGTERM.
+    void run();
+
+private:
+    StoryServer(const StoryServer &);
+    StoryServer & operator=(const StoryServer &);
+
+    // one connection's state.
+    struct Session{
+        Session(const Story & story);
+
+        ReaderSession reader; // the reader's place in the story
+        bool over; // the story ended or the reader closed its side
+        uint32_t events; // what epoll watches the socket for
+        std::string in; // input not yet answered
+        std::string out; // output not yet written
+    };
+
+    // accept every pending connection.
+    void acceptSessions();
+
+    // read what a session sent and answer each complete line.
+    void readSession(int fd);
+
+    // answer each complete line of a session's input.
+    void answerLines(Session & session);
+
+    // answer one line of input, as readCYOA does.
+    void answer(Session & session, const std::string & line);
+
+    // write a session's pending output; close it once it is over and written.
+    void writeSession(int fd);
+
+    // close a session.
+    void closeSession(int fd);
+
+    const Story & story;
+    std::string socket_path;
+    int listen_fd;
+    int epoll_fd;
+    std::vector<Session *> sessions; // indexed by fd, NULL if the fd is no session
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "StoryStructure.hpp"
+#include "Output.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Construct a new StoryStructure object
+ * 
+ * @param graph the story graph.
+ * @param is_win whether each page is a WIN page, indexed by page number.
+ */
+StoryStructure::StoryStructure(const StoryGraph & graph, const std::vector<bool> & is_win): graph(graph), is_win(is_win), reachable_num(0), component_num(0), loops(), idom(), win_pages(), mandatory() {}
+
+/**
+ * @brief find the loops, the dominators and the pages on every winning
+ * route. The components come from one Tarjan search and the dominator tree
+ * from one Lengauer-Tarjan pass. Then the WIN pages under each page of the
+ * dominator tree are counted, children before parents: a page dominates
+ * every WIN page exactly when it has all of them under it.
+ * 
+ */
+void StoryStructure::analyze(){
+    size_t page_num = graph.getPageNum();
+    std::vector<uint32_t> component;
+    component_num = graph.findComponents(component);
+
+    // a component is a loop if it has two pages, or one choosing itself.
+    std::vector<uint32_t> size(component_num + 1, 0);
+    std::vector<bool> cyclic(component_num + 1, false);
+    reachable_num = 0;
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        if(component[pn] == 0){
+            continue;
+        }
+        ++reachable_num;
+        if(++size[component[pn]] > 1){
+            cyclic[component[pn]] = true;
+        }
+        Span<uint32_t> options = graph.getChoices(pn);
+        if(std::find(options.begin(), options.end(), pn) != options.end()){
+            cyclic[component[pn]] = true;
+        }
+    }
+    std::vector<uint32_t> loop_index(component_num + 1, UINT32_MAX);
+    loops.clear();
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        uint32_t c = component[pn];
+        if(c == 0 || !cyclic[c]){
+            continue;
+        }
+        if(loop_index[c] == UINT32_MAX){
+            loop_index[c] = loops.size();
+            loops.push_back(std::vector<uint32_t>());
+        }
+        loops[loop_index[c]].push_back(pn);
+    }
+
+    graph.findDominators(idom);
+    win_pages.clear();
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        if(component[pn] != 0 && is_win[pn]){
+            win_pages.push_back(pn);
+        }
+    }
+
+    // the dominator tree, parents before children.
+    std::vector<uint32_t> first(page_num + 2, 0), children(page_num);
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        ++first[idom[pn] + 1];
+    }
+    for(size_t pn = 1; pn < first.size(); ++pn){
+        first[pn] += first[pn - 1];
+    }
+    std::vector<uint32_t> fill(first);
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        if(idom[pn] != 0){
+            children[fill[idom[pn]]++] = pn;
+        }
+    }
+    std::vector<uint32_t> order(1, 1);
+    for(size_t i = 0; i < order.size() && page_num > 0; ++i){
+        uint32_t pn = order[i];
+        order.insert(order.end(), children.begin() + first[pn], children.begin() + fill[pn]);
+    }
+
+    std::vector<uint32_t> wins_under(page_num + 1, 0);
+    for(size_t i = order.size(); i-- > 0; ){
+        uint32_t pn = order[i];
+        wins_under[pn] += is_win[pn];
+        if(idom[pn] != 0){
+            wins_under[idom[pn]] += wins_under[pn];
+        }
+    }
+    mandatory.clear();
+    for(size_t i = 0; i < order.size() && !win_pages.empty(); ++i){
+        if(wins_under[order[i]] == win_pages.size()){
+            mandatory.push_back(order[i]);
+        }
+    }
+}
+
+/**
+ * @brief get the number of pages reachable from page 1.
+ * 
+ * @return size_t the number of pages.
+ */
+size_t StoryStructure::getReachableNum() const{
+    return reachable_num;
+}
+
+/**
+ * @brief get the number of strongly connected components reachable from
+ * page 1, loops or single pages.
+ * 
+ * @return size_t the number of components.
+ */
+size_t StoryStructure::getComponentNum() const{
+    return component_num;
+}
+
+/**
+ * @brief get the loops: the components of two or more pages, or of one page
+ * choosing itself.
+ * 
+ * @return const std::vector<std::vector<uint32_t> >& the pages of each loop,
+ * in ascending order; loops in the order of their first page.
+ */
+const std::vector<std::vector<uint32_t> > & StoryStructure::getLoops() const{
+    return loops;
+}
+
+/**
+ * @brief get a page's immediate dominator: the last page before it on every
+ * route from page 1 to it.
+ * 
+ * @param pn page number.
+ * @return uint32_t the dominator; 0 for page 1 and unreachable pages.
+ */
+uint32_t StoryStructure::getDominator(size_t pn) const{
+    return idom[pn];
+}
+
+/**
+ * @brief get the pages every route from page 1 to a page goes through.
+ * 
+ * @param pn page number.
+ * @return std::vector<uint32_t> page 1 first and the page last; empty if the
+ * page is not reachable.
+ */
+std::vector<uint32_t> StoryStructure::getDominators(size_t pn) const{
+    std::vector<uint32_t> chain;
+    if(pn != 1 && idom[pn] == 0){
+        return chain;
+    }
+    for(uint32_t d = pn; d != 0; d = idom[d]){
+        chain.push_back(d);
+    }
+    std::reverse(chain.begin(), chain.end());
+    return chain;
+}
+
+/**
+ * @brief get the WIN pages reachable from page 1.
+ * 
+ * @return const std::vector<uint32_t>& the pages, in ascending order.
+ */
+const std::vector<uint32_t> & StoryStructure::getWinPages() const{
+    return win_pages;
+}
+
+/**
+ * @brief get the pages every winning route goes through.
+ * 
+ * @return const std::vector<uint32_t>& page 1 first, in route order; empty
+ * if the story is unwinnable.
+ */
+const std::vector<uint32_t> & StoryStructure::getMandatory() const{
+    return mandatory;
+}
+
+/**
+ * @brief append a list of page numbers as a JSON array.
+ * 
+ * @param pages the page numbers.
+ * @param out the array is appended here.
+ */
+static void appendPages(const std::vector<uint32_t> & pages, std::string & out){
+    out += '[';
+    for(size_t i = 0; i < pages.size(); ++i){
+        if(i > 0){
+            out += ',';
+        }
+        appendNumber(out, pages[i]);
+    }
+    out += ']';
+}
+
+/**
+ * @brief append the structure as one JSON object, one member per line:
+ * {"pages":N,"reachable":R,"components":C,
+ * "loops":[[P,...],...],
+ * "dominators":[D1,D2,...], the immediate dominator of each page, 0 for none,
+ * "wins":[{"page":W,"dominators":[1,...,W]},...],
+ * "mandatory":[1,...]}
+ * 
+ * @param out the JSON is appended here.
+ */
+void StoryStructure::appendSummary(std::string & out) const{
+    size_t page_num = graph.getPageNum();
+    out += "{\"pages\":";
+    appendNumber(out, page_num);
+    out += ",\"reachable\":";
+    appendNumber(out, reachable_num);
+    out += ",\"components\":";
+    appendNumber(out, component_num);
+    out += ",\n\"loops\":[";
+    for(size_t i = 0; i < loops.size(); ++i){
+        if(i > 0){
+            out += ',';
+        }
+        appendPages(loops[i], out);
+    }
+    out += "],\n\"dominators\":";
+    appendPages(std::vector<uint32_t>(idom.begin() + 1, idom.end()), out);
+    out += ",\n\"wins\":[";
+    for(size_t i = 0; i < win_pages.size(); ++i){
+        out += i > 0? ",{\"page\":" : "{\"page\":";
+        appendNumber(out, win_pages[i]);
+        out += ",\"dominators\":";
+        appendPages(getDominators(win_pages[i]), out);
+        out += '}';
+    }
+    out += "],\n\"mandatory\":";
+    appendPages(mandatory, out);
+    out += "}\n";
+}
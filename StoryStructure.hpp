@@ -0,0 +1,57 @@
+#ifndef STORY_STRUCTURE_HPP
+#define STORY_STRUCTURE_HPP
+
+#include <string>
+#include <vector>
+#include "StoryGraph.hpp"
+
+// the structure of a story, found in near-linear time instead of by listing
+// routes: its loops (strongly connected components with a cycle), the
+// dominator tree from page 1, the pages every route to each WIN page goes
+// through, and the pages every winning route goes through. A page on every
+// route to a page is on every route that never visits a page twice, so these
+// are the answers for the routes cyoa-step4 lists.
+class StoryStructure{
+public:
+    // constructor: is_win[pn] tells whether page pn is a WIN page.
+    StoryStructure(const StoryGraph & graph, const std::vector<bool> & is_win);
+
+    // find the loops, the dominators and the pages on every winning route.
+    void analyze();
+
+    // get the number of pages reachable from page 1.
+    size_t getReachableNum() const;
+
+    // get the number of strongly connected components reachable from page 1.
+    size_t getComponentNum() const;
+
+    // get the pages of each loop, in ascending order; loops by their first page.
+    const std::vector<std::vector<uint32_t> > & getLoops() const;
+
+    // get a page's immediate dominator; 0 for page 1 and unreachable pages.
+    uint32_t getDominator(size_t pn) const;
+
+    // get the pages every route to a page goes through, page 1 first and the page last.
+    std::vector<uint32_t> getDominators(size_t pn) const;
+
+    // get the WIN pages reachable from page 1.
+    const std::vector<uint32_t> & getWinPages() const;
+
+    // get the pages every winning route goes through, page 1 first.
+    const std::vector<uint32_t> & getMandatory() const;
+
+    // append the structure as one JSON object.
+    void appendSummary(std::string & out) const;
+
+private:
+    const StoryGraph & graph;
+    const std::vector<bool> & is_win;
+    size_t reachable_num;
+    size_t component_num;
+    std::vector<std::vector<uint32_t> > loops;
+    std::vector<uint32_t> idom; // immediate dominator of each page, indexed by page number
+    std::vector<uint32_t> win_pages;
+    std::vector<uint32_t> mandatory;
+};
+
+#endif
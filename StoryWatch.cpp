@@ -0,0 +1,534 @@
+#include "StoryWatch.hpp"
+#include "Parallel.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// quiet time that ends a burst of events; editors save in several steps.
+static const int SETTLE_MS = 20;
+// page files numbered beyond twice the page files present, plus this, are
+// kept out of the page arrays until the story can reach them.
+static const size_t FAR_PAGE_SLACK = 1024;
+
+/**
+ * @brief print one page's depth, as Story::printDepth does.
+ * 
+ * @param out the output.
+ * @param pn page number.
+ * @param depth the page's depth.
+ */
+static void printDepthLine(OutputBuffer & out, size_t pn, uint32_t depth){
+    out.write("Page ");
+    out.writeNumber(pn);
+    if(depth != StoryGraph::UNREACHABLE){
+        out.writeChar(':');
+        out.writeNumber(depth);
+        out.writeChar('\n');
+    }
+    else{
+        out.write(" is not reachable\n");
+    }
+}
+
+/**
+ * @brief Construct a new StoryWatch::WatchedPage object, for a file not seen yet.
+ * 
+ */
+StoryWatch::WatchedPage::WatchedPage(): present(false), parsed(false), active(false), error(), type(PAGE_NOTYPE), choices() {}
+
+/**
+ * @brief Construct a new StoryWatch::StoryWatch object. The directory is
+ * watched before it is listed, so no change made meanwhile is missed.
+ * 
+ * @param dir story directory.
+ * @param thread_num number of threads parsing pages.
+ */
+StoryWatch::StoryWatch(const std::string & dir, size_t thread_num): dir(dir), thread_num(thread_num), inotify_fd(-1), entries(1), changed(), far_pages(), present_num(0), page_num(0), refs(1), far_refs(), broken(), win_num(0), lose_num(0), out_of_bound(0), unreferenced(0), removed(), added(), depth(), depth_found(false), depth_changed(), reported(), parsed_num(0) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd < 0 || inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE
+                                           | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0){
+        findError("The story directory cannot be watched!");
+    }
+    listPages();
+}
+
+/**
+ * @brief Destroy the StoryWatch::StoryWatch object
+ * 
+ */
+StoryWatch::~StoryWatch(){
+    if(inotify_fd >= 0){
+        close(inotify_fd);
+    }
+}
+
+/**
+ * @brief report the story, then wait for changes; each burst of changes is
+ * parsed and reported once it settles.
+ * 
+ */
+void StoryWatch::run(){
+    update();
+    struct pollfd pfd;
+    pfd.fd = inotify_fd;
+    pfd.events = POLLIN;
+    while(true){
+        if(poll(&pfd, 1, -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            findError("The story directory cannot be watched!");
+        }
+        readEvents();
+        while(poll(&pfd, 1, SETTLE_MS) > 0){
+            readEvents();
+        }
+        if(!changed.empty()){
+            update();
+        }
+    }
+}
+
+/**
+ * @brief mark every page file of the directory present and changed, and
+ * every page file no longer there gone.
+ * 
+ */
+void StoryWatch::listPages(){
+    for(size_t pn = 1; pn < entries.size(); ++pn){
+        if(entries[pn].present){
+            markChanged(pn, false);
+        }
+    }
+    std::vector<size_t> far(far_pages.begin(), far_pages.end());
+    for(size_t i = 0; i < far.size(); ++i){
+        markChanged(far[i], false);
+    }
+    DIR * d = opendir(dir.c_str());
+    if(d == NULL){
+        findError("The story directory cannot be read!");
+    }
+    struct dirent * entry;
+    while((entry = readdir(d)) != NULL){
+        size_t pn = Story::pageFileNumber(entry->d_name);
+        if(pn != 0){
+            markChanged(pn, true);
+        }
+    }
+    closedir(d);
+}
+
+/**
+ * @brief read the pending inotify events and mark the page files they name.
+ * When events were lost, the whole directory is listed again.
+ * 
+ */
+void StoryWatch::readEvents(){
+    alignas(struct inotify_event) char buffer[1 << 16];
+    ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+    if(len < 0){
+        if(errno == EINTR || errno == EAGAIN){
+            return;
+        }
+        findError("The story directory cannot be watched!");
+    }
+    for(char * p = buffer; p < buffer + len; ){
+        const struct inotify_event * event = (const struct inotify_event *)p;
+        p += sizeof(struct inotify_event) + event->len;
+        if(event->mask & IN_Q_OVERFLOW){
+            listPages();
+        }
+        else if(event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)){
+            findError("The story directory is gone!");
+        }
+        else if(event->len > 0){
+            size_t pn = Story::pageFileNumber(event->name);
+            if(pn != 0){
+                markChanged(pn, (event->mask & (IN_DELETE | IN_MOVED_FROM)) == 0);
+            }
+        }
+    }
+}
+
+/**
+ * @brief mark a page file changed. A page numbered far beyond the page
+ * files present can't be in the story yet, so only its presence is kept.
+ * 
+ * @param pn page number.
+ * @param present whether the file exists now.
+ */
+void StoryWatch::markChanged(size_t pn, bool present){
+    if(pn >= entries.size() && pn > 2 * present_num + FAR_PAGE_SLACK){
+        if(present && far_pages.insert(pn).second){
+            ++present_num;
+        }
+        else if(!present && far_pages.erase(pn) > 0){
+            --present_num;
+        }
+        return;
+    }
+    if(pn >= entries.size()){
+        growEntries(pn + 1);
+    }
+    WatchedPage & page = entries[pn];
+    if(page.present != present){
+        present ? ++present_num : --present_num;
+    }
+    page.present = present;
+    page.parsed = false;
+    changed.push_back(pn);
+}
+
+/**
+ * @brief make room for more page numbers, moving the referrers of the new
+ * numbers out of far_refs.
+ * 
+ * @param size the new size of entries and refs.
+ */
+void StoryWatch::growEntries(size_t size){
+    entries.resize(size);
+    refs.resize(size);
+    while(!far_refs.empty() && far_refs.begin()->first < size){
+        refs[far_refs.begin()->first].swap(far_refs.begin()->second);
+        far_refs.erase(far_refs.begin());
+    }
+}
+
+/**
+ * @brief parse the changed pages of the story and the pages joining it,
+ * patch the references, counts and depths, and report the story. Pages
+ * leaving the story, or changed, are taken out first, so every count always
+ * matches the pages counted in.
+ * 
+ */
+void StoryWatch::update(){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(!far_pages.empty() && *far_pages.begin() <= 2 * present_num + FAR_PAGE_SLACK){
+        size_t pn = *far_pages.begin();
+        far_pages.erase(far_pages.begin());
+        if(pn >= entries.size()){
+            growEntries(pn + 1);
+        }
+        entries[pn].present = true;
+        changed.push_back(pn);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    size_t old_num = page_num, new_num = 0;
+    while(new_num + 1 < entries.size() && entries[new_num + 1].present){
+        ++new_num;
+    }
+    for(size_t i = 0; i < changed.size() && changed[i] <= old_num; ++i){
+        deactivate(changed[i]);
+    }
+    for(size_t pn = new_num + 1; pn <= old_num; ++pn){
+        deactivate(pn);
+    }
+    setPageNum(new_num);
+
+    std::vector<size_t> joining; // pages of the story not counted in
+    for(size_t i = 0; i < changed.size() && changed[i] <= new_num; ++i){
+        if(changed[i] <= old_num){
+            joining.push_back(changed[i]);
+        }
+    }
+    for(size_t pn = old_num + 1; pn <= new_num; ++pn){
+        joining.push_back(pn);
+    }
+    std::vector<size_t> todo;
+    for(size_t i = 0; i < joining.size(); ++i){
+        if(!entries[joining[i]].parsed){
+            todo.push_back(joining[i]);
+        }
+    }
+    parallelFor(todo.size(), thread_num, [&](size_t i){
+        WatchedPage & page = entries[todo[i]];
+        Page parsed;
+        try{
+            parsed.readPage(Story::getFileName(dir, todo[i]).c_str(), false);
+            page.error.clear();
+            page.type = parsed.getType();
+            page.choices = parsed.getChoices();
+        }
+        catch(StoryError & e){
+            page.error = e.what();
+            page.choices.clear();
+        }
+        page.parsed = true;
+    });
+    parsed_num += todo.size();
+    for(size_t i = 0; i < joining.size(); ++i){
+        activate(joining[i]);
+    }
+    changed.clear();
+
+    if(new_num != old_num || depth.size() != page_num + 1){
+        findDepths();
+    }
+    else{
+        patchDepths();
+    }
+    removed.clear();
+    added.clear();
+
+    std::string error = check();
+    OutputBuffer out;
+    if(error.empty()){
+        printDepths(out);
+    }
+    char status[64];
+    snprintf(status, sizeof(status), " pages in %.3f ms: ",
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    out.write("Checked ");
+    out.writeNumber(parsed_num);
+    out.write(status);
+    out.write(error.empty()? "the story is valid." : error);
+    out.writeChar('\n');
+    parsed_num = 0;
+}
+
+/**
+ * @brief count a page in the story: a broken page by its error, any other
+ * by its type and its choices.
+ * 
+ * @param pn page number, at most page_num.
+ */
+void StoryWatch::activate(size_t pn){
+    WatchedPage & page = entries[pn];
+    if(page.active){
+        return;
+    }
+    page.active = true;
+    if(!page.error.empty()){
+        broken.insert(pn);
+        return;
+    }
+    win_num += page.type == PAGE_WIN;
+    lose_num += page.type == PAGE_LOSE;
+    for(size_t i = 0; i < page.choices.size(); ++i){
+        size_t target = page.choices[i];
+        std::vector<uint32_t> & from = referrers(target);
+        from.push_back(pn);
+        if(target > page_num){
+            ++out_of_bound;
+        }
+        else if(from.size() == 1 && target > 1){
+            --unreferenced;
+        }
+        added.push_back(std::pair<size_t, size_t>(pn, target));
+    }
+}
+
+/**
+ * @brief take a page out of the story, undoing activate.
+ * 
+ * @param pn page number.
+ */
+void StoryWatch::deactivate(size_t pn){
+    WatchedPage & page = entries[pn];
+    if(!page.active){
+        return;
+    }
+    page.active = false;
+    if(!page.error.empty()){
+        broken.erase(pn);
+        return;
+    }
+    win_num -= page.type == PAGE_WIN;
+    lose_num -= page.type == PAGE_LOSE;
+    for(size_t i = 0; i < page.choices.size(); ++i){
+        size_t target = page.choices[i];
+        std::vector<uint32_t> & from = referrers(target);
+        from.erase(std::find(from.rbegin(), from.rend(), pn).base() - 1);
+        if(target > page_num){
+            --out_of_bound;
+        }
+        else if(from.empty() && target > 1){
+            ++unreferenced;
+        }
+        if(from.empty() && target >= refs.size()){
+            far_refs.erase(target);
+        }
+        removed.push_back(std::pair<size_t, size_t>(pn, target));
+    }
+}
+
+/**
+ * @brief move the end of the story. Choices of pages beyond it become out of
+ * bound, pages before it need a referrer.
+ * 
+ * @param new_num the new page number, smaller than entries.size().
+ */
+void StoryWatch::setPageNum(size_t new_num){
+    for(size_t pn = page_num + 1; pn <= new_num; ++pn){
+        out_of_bound -= refs[pn].size();
+        unreferenced += pn > 1 && refs[pn].empty();
+    }
+    for(size_t pn = new_num + 1; pn <= page_num; ++pn){
+        out_of_bound += refs[pn].size();
+        unreferenced -= pn > 1 && refs[pn].empty();
+    }
+    page_num = new_num;
+}
+
+/**
+ * @brief get the pages choosing a page, once per choice.
+ * 
+ * @param target the page chosen.
+ * @return std::vector<uint32_t>& the referrers.
+ */
+std::vector<uint32_t> & StoryWatch::referrers(size_t target){
+    return target < refs.size()? refs[target] : far_refs[target];
+}
+
+/**
+ * @brief calculate every page's depth again, breadth first from page 1.
+ * 
+ */
+void StoryWatch::findDepths(){
+    depth.assign(page_num + 1, StoryGraph::UNREACHABLE);
+    depth_found = true;
+    if(page_num == 0){
+        return;
+    }
+    std::vector<size_t> queue(1, 1);
+    depth[1] = 0;
+    for(size_t i = 0; i < queue.size(); ++i){
+        const WatchedPage & page = entries[queue[i]];
+        if(!page.error.empty()){
+            continue;
+        }
+        for(size_t j = 0; j < page.choices.size(); ++j){
+            size_t target = page.choices[j];
+            if(target <= page_num && depth[target] == StoryGraph::UNREACHABLE){
+                depth[target] = depth[queue[i]] + 1;
+                queue.push_back(target);
+            }
+        }
+    }
+}
+
+/**
+ * @brief patch the depths for the choices removed and added since the last
+ * update. While every page that lost a choice leading to it at its depth
+ * keeps another such choice, no depth grows, and the added choices can only
+ * lower depths, which spreads from their targets. Otherwise the depths are
+ * calculated again.
+ * 
+ */
+void StoryWatch::patchDepths(){
+    for(size_t i = 0; i < removed.size(); ++i){
+        size_t from = removed[i].first, target = removed[i].second;
+        if(target > page_num || depth[from] == StoryGraph::UNREACHABLE || depth[target] != depth[from] + 1){
+            continue;
+        }
+        const std::vector<uint32_t> & others = refs[target];
+        bool kept = false;
+        for(size_t j = 0; j < others.size() && !kept; ++j){
+            kept = depth[others[j]] != StoryGraph::UNREACHABLE && depth[others[j]] + 1 == depth[target];
+        }
+        if(!kept){
+            findDepths();
+            return;
+        }
+    }
+
+    std::vector<size_t> queue;
+    for(size_t i = 0; i < added.size(); ++i){
+        lowerDepth(added[i].first, added[i].second, queue);
+    }
+    for(size_t i = 0; i < queue.size(); ++i){
+        const WatchedPage & page = entries[queue[i]];
+        if(page.error.empty()){
+            for(size_t j = 0; j < page.choices.size(); ++j){
+                lowerDepth(queue[i], page.choices[j], queue);
+            }
+        }
+    }
+}
+
+/**
+ * @brief lower a page's depth through one choice leading to it.
+ * 
+ * @param from the page choosing.
+ * @param target the page chosen.
+ * @param queue target is appended when its depth is lowered.
+ */
+void StoryWatch::lowerDepth(size_t from, size_t target, std::vector<size_t> & queue){
+    if(target <= page_num && depth[from] != StoryGraph::UNREACHABLE && depth[from] + 1 < depth[target]){
+        depth[target] = depth[from] + 1;
+        depth_changed.push_back(target);
+        queue.push_back(target);
+    }
+}
+
+/**
+ * @brief get the error the full load and checkPages would print: a missing
+ * page 1, the lowest broken page, a choice out of bound, no WIN or LOSE
+ * page, or a page nobody chooses.
+ * 
+ * @return std::string the error, or an empty string for a valid story.
+ */
+std::string StoryWatch::check() const{
+    if(page_num == 0){
+        return "page 1.txt dose not exist!";
+    }
+    if(page_num > UINT32_MAX){
+        return "The story has too many pages!";
+    }
+    if(!broken.empty()){
+        return entries[*broken.begin()].error;
+    }
+    if(out_of_bound > 0){
+        return "There is a page number out of bound!";
+    }
+    if(win_num == 0 || lose_num == 0){
+        return "At least one page must be a WIN page and at least one page must be a LOSE page.";
+    }
+    if(unreferenced > 0){
+        return "Every page is referenced by at least one *other* page's choices.";
+    }
+    return "";
+}
+
+/**
+ * @brief print the depths that changed since the last report, or all of
+ * them when the story got longer or shorter.
+ * 
+ * @param out the output.
+ */
+void StoryWatch::printDepths(OutputBuffer & out){
+    if(reported.size() != depth.size()){
+        for(size_t pn = 1; pn <= page_num; ++pn){
+            printDepthLine(out, pn, depth[pn]);
+        }
+        reported = depth;
+    }
+    else if(depth_found){
+        for(size_t pn = 1; pn <= page_num; ++pn){
+            if(depth[pn] != reported[pn]){
+                printDepthLine(out, pn, depth[pn]);
+                reported[pn] = depth[pn];
+            }
+        }
+    }
+    else{
+        std::sort(depth_changed.begin(), depth_changed.end());
+        depth_changed.erase(std::unique(depth_changed.begin(), depth_changed.end()), depth_changed.end());
+        for(size_t i = 0; i < depth_changed.size(); ++i){
+            size_t pn = depth_changed[i];
+            if(depth[pn] != reported[pn]){
+                printDepthLine(out, pn, depth[pn]);
+                reported[pn] = depth[pn];
+            }
+        }
+    }
+    depth_found = false;
+    depth_changed.clear();
+}
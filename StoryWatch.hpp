@@ -0,0 +1,104 @@
+#ifndef STORY_WATCH_HPP
+#define STORY_WATCH_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "CYOA.hpp"
+
+// keeps a story directory checked while it is edited. Only the page files
+// that changed are parsed again; the references, the WIN/LOSE counts and the
+// depths are patched, and the story is reported as the full load and
+// cyoa-step3 would report it.
+class StoryWatch{
+public:
+    // constructor: parse every page of the directory with up to thread_num threads.
+    StoryWatch(const std::string & dir, size_t thread_num = 1);
+    // destructor
+    ~StoryWatch();
+
+    // report the story, then watch the directory and report each change, forever.
+    void run();
+
+private:
+    StoryWatch(const StoryWatch &);
+    StoryWatch & operator=(const StoryWatch &);
+
+    // one page file's state.
+    struct WatchedPage{
+        WatchedPage();
+
+        bool present; // the file exists
+        bool parsed; // error, type and choices are the file's current content
+        bool active; // counted in the story: in broken if error, else in refs and the type counts
+        std::string error; // the page's format error, or empty
+        PageType type;
+        std::vector<size_t> choices;
+    };
+
+    // mark every page file of the directory present and changed.
+    void listPages();
+
+    // read the pending inotify events.
+    void readEvents();
+
+    // mark a page file changed.
+    void markChanged(size_t pn, bool present);
+
+    // make room for more page numbers.
+    void growEntries(size_t size);
+
+    // parse the changed pages of the story, patch the story and report it.
+    void update();
+
+    // count a page in the story.
+    void activate(size_t pn);
+
+    // take a page out of the story.
+    void deactivate(size_t pn);
+
+    // move the end of the story, keeping the counts of the pages beyond it.
+    void setPageNum(size_t new_num);
+
+    // get the pages choosing a page.
+    std::vector<uint32_t> & referrers(size_t target);
+
+    // calculate every page's depth again.
+    void findDepths();
+
+    // patch the depths for the removed and added choices.
+    void patchDepths();
+
+    // lower a page's depth through one choice leading to it.
+    void lowerDepth(size_t from, size_t target, std::vector<size_t> & queue);
+
+    // get the error the full load would print, or an empty string.
+    std::string check() const;
+
+    // print the depths that changed since the last report.
+    void printDepths(OutputBuffer & out);
+
+    std::string dir; // story directory
+    size_t thread_num; // threads parsing pages
+    int inotify_fd;
+    std::vector<WatchedPage> entries; // indexed by page number
+    std::vector<size_t> changed; // page numbers marked changed since the last update
+    std::set<size_t> far_pages; // page files present, numbered too far to be in entries
+    size_t present_num; // page files present
+    size_t page_num; // the story is page 1 to page_num
+    std::vector<std::vector<uint32_t> > refs; // pages choosing each page, indexed by page number
+    std::map<size_t, std::vector<uint32_t> > far_refs; // the same, for choices beyond refs
+    std::set<size_t> broken; // pages in the story with a format error
+    size_t win_num, lose_num; // WIN and LOSE pages in the story
+    size_t out_of_bound; // choices beyond page_num
+    size_t unreferenced; // pages after page 1 that no page chooses
+    std::vector<std::pair<size_t, size_t> > removed, added; // choices (page, target) since the last update
+    std::vector<uint32_t> depth; // depth of each page, indexed by page number
+    bool depth_found; // depth was calculated again since the last report
+    std::vector<size_t> depth_changed; // pages whose depth was patched since the last report
+    std::vector<uint32_t> reported; // depths as last reported
+    size_t parsed_num; // pages parsed since the last report
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "Validate.hpp"
+#include "Parallel.hpp"
+
+/**
+ * @brief add a problem to a report.
+ * 
+ * @param report the report.
+ * @param page page number, 0 for the whole story.
+ * @param line line number, 0 when it is not on one line.
+ * @param choice choice number, 0 when it is not one choice.
+ * @param error error information, as findError would print it.
+ */
+static void addProblem(StoryReport & report, size_t page, size_t line, size_t choice, const std::string & error){
+    StoryProblem problem = {page, line, choice, error};
+    report.problems.push_back(problem);
+}
+
+/**
+ * @brief append a string as a JSON string.
+ * 
+ * @param str the string.
+ * @param out the JSON is appended here.
+ */
+static void appendJson(const std::string & str, std::string & out){
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    for(size_t i = 0; i < str.size(); ++i){
+        unsigned char c = str[i];
+        if(c == '"' || c == '\\'){
+            out += '\\';
+            out += c;
+        }
+        else if(c < 0x20){
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 15];
+        }
+        else{
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief check a story directory as the full load and checkPages do, but
+ * collect every problem: each bad line of each page, each choice out of
+ * bound, a missing WIN or LOSE page and each page nobody chooses. Only the
+ * navigation sections are read.
+ * 
+ * @param dir story directory.
+ * @param report the problems are added here.
+ */
+void validateStory(const std::string & dir, StoryReport & report){
+    report.story = dir;
+    report.page_num = 0;
+    report.problems.clear();
+    if(isStoryFile(dir)){
+        addProblem(report, 0, 0, 0, "This is a compiled story; validate its directory instead!");
+        return;
+    }
+    std::vector<std::string> files = Story::scanPages(dir);
+    if(files.empty()){
+        addProblem(report, 0, 0, 0, "page 1.txt dose not exist!");
+        return;
+    }
+    size_t page_num = files.size();
+    report.page_num = page_num;
+    if(page_num > UINT32_MAX){
+        addProblem(report, 0, 0, 0, "The story has too many pages!");
+        return;
+    }
+
+    size_t win_num = 0, lose_num = 0;
+    std::vector<bool> referenced(page_num + 1, false);
+    std::vector<PageProblem> page_problems;
+    for(size_t pn = 1; pn <= page_num; ++pn){
+        Page page;
+        page_problems.clear();
+        page.readPage(files[pn - 1].c_str(), false, &page_problems);
+        for(size_t i = 0; i < page_problems.size(); ++i){
+            addProblem(report, pn, page_problems[i].line, 0, page_problems[i].error);
+        }
+        win_num += page.getType() == PAGE_WIN;
+        lose_num += page.getType() == PAGE_LOSE;
+        const std::vector<size_t> & choices = page.getChoices();
+        for(size_t i = 0; i < choices.size(); ++i){
+            if(choices[i] > page_num){
+                addProblem(report, pn, 0, i + 1, "There is a page number out of bound!");
+            }
+            else{
+                referenced[choices[i]] = true;
+            }
+        }
+    }
+
+    if(win_num == 0 || lose_num == 0){
+        addProblem(report, 0, 0, 0, "At least one page must be a WIN page and at least one page must be a LOSE page.");
+    }
+    for(size_t pn = 2; pn <= page_num; ++pn){
+        if(!referenced[pn]){
+            addProblem(report, pn, 0, 0, "Every page is referenced by at least one *other* page's choices.");
+        }
+    }
+}
+
+/**
+ * @brief validate many story directories, one story per thread at a time.
+ * 
+ * @param dirs story directories.
+ * @param thread_num number of threads.
+ * @return std::vector<StoryReport> one report per directory, in order.
+ */
+std::vector<StoryReport> validateStories(const std::vector<std::string> & dirs, size_t thread_num){
+    std::vector<StoryReport> reports(dirs.size());
+    parallelFor(dirs.size(), thread_num, [&](size_t i){
+        validateStory(dirs[i], reports[i]);
+    });
+    return reports;
+}
+
+/**
+ * @brief append a report as one JSON object:
+ * {"story":...,"pages":N,"valid":...,"errors":[{"page":P,"line":L,"choice":C,"error":...}]},
+ * leaving out page, line and choice where they are 0.
+ * 
+ * @param report the report.
+ * @param out the JSON is appended here.
+ */
+void appendReport(const StoryReport & report, std::string & out){
+    out += "{\"story\":";
+    appendJson(report.story, out);
+    out += ",\"pages\":";
+    appendNumber(out, report.page_num);
+    out += report.problems.empty()? ",\"valid\":true" : ",\"valid\":false";
+    out += ",\"errors\":[";
+    for(size_t i = 0; i < report.problems.size(); ++i){
+        const StoryProblem & problem = report.problems[i];
+        out += i > 0? ",{" : "{";
+        if(problem.page > 0){
+            out += "\"page\":";
+            appendNumber(out, problem.page);
+            out += ',';
+        }
+        if(problem.line > 0){
+            out += "\"line\":";
+            appendNumber(out, problem.line);
+            out += ',';
+        }
+        if(problem.choice > 0){
+            out += "\"choice\":";
+            appendNumber(out, problem.choice);
+            out += ',';
+        }
+        out += "\"error\":";
+        appendJson(problem.error, out);
+        out += '}';
+    }
+    out += "]}";
+}
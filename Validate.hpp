@@ -0,0 +1,35 @@
+#ifndef VALIDATE_HPP
+#define VALIDATE_HPP
+
+#include <string>
+#include <vector>
+#include "CYOA.hpp"
+
+// one problem of a story. page is 0 for a problem of the whole story, line
+// is 0 when it is not on one line, choice is 0 when it is not one choice.
+struct StoryProblem{
+    size_t page;
+    size_t line;
+    size_t choice;
+    std::string error;
+};
+
+// every problem found in one story directory.
+struct StoryReport{
+    std::string story;
+    size_t page_num;
+    std::vector<StoryProblem> problems;
+};
+
+// check a story directory as the full load and checkPages do, collecting
+// every problem instead of exiting on the first.
+void validateStory(const std::string & dir, StoryReport & report);
+
+// validate many story directories on up to thread_num threads; reports are
+// in the order of the directories.
+std::vector<StoryReport> validateStories(const std::vector<std::string> & dirs, size_t thread_num);
+
+// append a report as one JSON object.
+void appendReport(const StoryReport & report, std::string & out);
+
+#endif
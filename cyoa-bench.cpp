@@ -0,0 +1,123 @@
+#include "CYOA.hpp"
+#include "Options.hpp"
+#include "PageLoader.hpp"
+#include "Parallel.hpp"
+#include "RouteCount.hpp"
+
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief milliseconds since a point in time.
+ * 
+ * @param start the point in time.
+ * @return double elapsed milliseconds.
+ */
+static double elapsedMs(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief format milliseconds with microsecond precision.
+ * 
+ * @param ms milliseconds.
+ * @return std::string e.g. "12.345".
+ */
+static std::string formatMs(double ms){
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", ms);
+    return text;
+}
+
+/**
+ * @brief drop a file from the page cache, so it is read from the disk again.
+ * Only clean pages are dropped; the files were written long enough ago.
+ * 
+ * @param file_name file name.
+ */
+static void evictFile(const std::string & file_name){
+    int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd >= 0){
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/**
+ * @brief drop a story from the page cache: a compiled story file, or every
+ * page file of a story directory.
+ * 
+ * @param story story directory or compiled story file.
+ */
+static void evictStory(const std::string & story){
+    if(isStoryFile(story)){
+        evictFile(story);
+        return;
+    }
+    std::vector<std::string> files = Story::scanPages(story);
+    for(size_t i = 0; i < files.size(); ++i){
+        evictFile(files[i]);
+    }
+}
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    bool count = options.takeFlag("--count");
+    bool routes = options.takeFlag("--routes");
+    bool cold = options.takeFlag("--cold");
+    std::string io_name;
+    if(options.takeValue("", "--io", io_name)){
+        if(io_name == "uring"){
+            PageLoader::setDefaultIo(PAGE_IO_URING);
+        }
+        else if(io_name == "pread"){
+            PageLoader::setDefaultIo(PAGE_IO_PREAD);
+        }
+        else{
+            findError("--io must be uring or pread!");
+        }
+    }
+    options.argumentCheck(2);
+    if(cold){
+        evictStory(options[1]);
+    }
+
+    // each phase timed on its own; the result is one JSON object per line.
+    PageIo io = PageLoader(1, 1, PageLoader::getDefaultIo()).getIo();
+    std::string result = "{\"story\":\"" + options[1] + "\",\"threads\":" + std::to_string(thread_num > 0? thread_num : defaultThreads())
+        + ",\"io\":\"" + PageLoader::getIoName(io) + "\",\"cold\":" + (cold? "true" : "false");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Story story(options[1], thread_num, false, false);
+    result += ",\"load_ms\":" + formatMs(elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    story.checkPages();
+    result += ",\"check_ms\":" + formatMs(elapsedMs(start));
+    const StoryGraph & graph = story.getGraph();
+    result += ",\"pages\":" + std::to_string(graph.getPageNum()) + ",\"choices\":" + std::to_string(graph.getChoiceNum());
+
+    start = std::chrono::steady_clock::now();
+    story.getPageDepth();
+    result += ",\"depth_ms\":" + formatMs(elapsedMs(start));
+    bool winnable = story.hasWin();
+    result += std::string(",\"winnable\":") + (winnable? "true" : "false");
+
+    if(count && winnable){
+        start = std::chrono::steady_clock::now();
+        std::vector<bool> is_win = story.getWinPages();
+        RouteCounter counter(graph, is_win);
+        counter.count();
+        result += ",\"count_ms\":" + formatMs(elapsedMs(start)) + ",\"winning_routes\":\"" + counter.getTotal().toString() + "\"";
+    }
+    if(routes && winnable){
+        start = std::chrono::steady_clock::now();
+        size_t route_num = story.getWinRoute().size();
+        result += ",\"routes_ms\":" + formatMs(elapsedMs(start)) + ",\"routes\":" + std::to_string(route_num);
+    }
+    std::cout << result << "}" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "Output.hpp"
+#include "Page.hpp"
+#include "Parallel.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// sessions played at once.
+static const size_t MAX_SESSIONS = 256;
+
+/**
+ * @brief play one session: send the script as the reader's input while
+ * collecting everything the server prints, until it closes the session.
+ * 
+ * @param socket_path the server's socket.
+ * @param script the reader's input lines.
+ * @param transcript the server's output.
+ */
+static void playSession(const std::string & socket_path, const std::string & script, std::string & transcript){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof(addr.sun_path)){
+        findError("The socket path is too long!");
+    }
+    memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        findError("The server cannot be reached!");
+    }
+
+    // read answers while sending: the server stops reading a session whose
+    // answers pile up, so sending the whole script first could deadlock.
+    size_t sent = 0;
+    bool sending = !script.empty();
+    if(!sending){
+        shutdown(fd, SHUT_WR);
+    }
+    char buffer[4096];
+    while(true){
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = sending? POLLIN | POLLOUT : POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        if(sending && (pfd.revents & (POLLOUT | POLLERR | POLLHUP))){
+            ssize_t n = send(fd, script.data() + sent, script.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(n > 0){
+                sent += n;
+            }
+            if((n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) || n == 0 || sent == script.size()){
+                sending = false; // done, or the story ended before the script did
+                shutdown(fd, SHUT_WR);
+            }
+        }
+        if(pfd.revents & (POLLIN | POLLERR | POLLHUP)){
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if(n < 0 && errno == EINTR){
+                continue;
+            }
+            if(n <= 0){
+                break;
+            }
+            transcript.append(buffer, n);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief read a whole script.
+ * 
+ * @param f the script stream.
+ * @return std::string its contents.
+ */
+static std::string readScript(std::istream & f){
+    std::string script;
+    char buffer[4096];
+    while(f.read(buffer, sizeof(buffer)) || f.gcount() > 0){
+        script.append(buffer, f.gcount());
+    }
+    return script;
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        findError("Wrong number of input arguments!");
+    }
+
+    // one session per script, all at once; standard input without scripts.
+    std::vector<std::string> scripts;
+    if(argc == 2){
+        scripts.push_back(readScript(std::cin));
+    }
+    for(int i = 2; i < argc; ++i){
+        std::ifstream f(argv[i], std::ios::binary);
+        if(!f.is_open()){
+            findError("file open unsuccessfully!");
+        }
+        scripts.push_back(readScript(f));
+    }
+
+    std::vector<std::string> transcripts(scripts.size());
+    parallelFor(scripts.size(), MAX_SESSIONS, [&](size_t i){
+        playSession(argv[1], scripts[i], transcripts[i]);
+    });
+    OutputBuffer out;
+    for(size_t i = 0; i < transcripts.size(); ++i){
+        out.write(transcripts[i]);
+    }
+    return EXIT_SUCCESS;
+}
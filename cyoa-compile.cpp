@@ -0,0 +1,13 @@
+#include "CYOA.hpp"
+#include "Options.hpp"
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    options.argumentCheck(3);
+
+    Story story(options[1], thread_num);
+    story.compile(options[2]);
+
+    return EXIT_SUCCESS;
+}
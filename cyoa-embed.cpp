@@ -0,0 +1,25 @@
+#include "CYOA.hpp"
+#include "Options.hpp"
+
+#include <cctype>
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    std::string name = "embedded_story";
+    options.takeValue("", "--name", name);
+    options.argumentCheck(3);
+    bool identifier = !name.empty() && !isdigit((unsigned char)name[0]);
+    for(size_t i = 0; i < name.size(); ++i){
+        identifier = identifier && (isalnum((unsigned char)name[i]) || name[i] == '_');
+    }
+    if(!identifier){
+        findError("--name must be a C++ identifier!");
+    }
+
+    // the page format is checked here; the story format is left to the compiler.
+    Story story(options[1], thread_num, false, false);
+    story.embed(options[2], name);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+#include "Options.hpp"
+#include "Parallel.hpp"
+#include "StoryGen.hpp"
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", defaultThreads());
+    size_t page_num = options.takeNumber("", "--pages", 1000);
+    size_t branch = options.takeNumber("", "--branch", 3);
+    size_t cycle_percent = options.takePercent("--cycles", 10);
+    size_t ending_percent = options.takePercent("--endings", 20);
+    size_t win_percent = options.takePercent("--wins", 50);
+    bool chain = options.takeFlag("--chain");
+    size_t text_lines = options.takeNumber("", "--text-lines", 3);
+    size_t seed = options.takeNumber("", "--seed", 1);
+    options.argumentCheck(2);
+
+    StoryGenerator generator(page_num, branch, cycle_percent, ending_percent, win_percent, chain, seed);
+    generator.generate();
+    generator.write(options[1], text_lines, thread_num);
+
+    return EXIT_SUCCESS;
+}
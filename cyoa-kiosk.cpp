@@ -0,0 +1,11 @@
+#include "CYOA.hpp"
+#include "kiosk_story.hpp"
+
+int main(){
+    // the story is in the program: nothing is read but the reader's choices.
+    Story story(kiosk_story::STORY);
+    ReaderSession session(story);
+    session.readCYOA();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,542 @@
+#include "Options.hpp"
+#include "Page.hpp"
+
+#include <cstring>
+#include <sstream>
+
+// what one parse of a page file gives: the error it was rejected with, or
+// the page, and the problems when they were collected.
+struct ParseResult{
+    std::string error; // the StoryError thrown, empty if none
+    PageType type;
+    std::vector<size_t> choices;
+    std::string labels;
+    std::vector<uint64_t> label_offsets;
+    std::string text;
+    uint64_t text_start;
+    std::vector<PageProblem> problems;
+};
+
+// ===================================================
+
+//                  Reference parser
+
+// ===================================================
+// the page parser as it was before the buffered scanner: getline over a
+// stream, isPositiveNum and atoi. It differs in two ways, both as Page does
+// now: a page number too large for atoi saturates to SIZE_MAX instead of
+// overflowing, and a choice on a WIN or LOSE page is rejected before it is
+// kept, on every such line instead of only the first.
+
+/**
+ * @brief the page number of a choice, as isPositiveNum and atoi read it.
+ * 
+ * @param str the text before the colon.
+ * @return size_t the number; 0 if it is empty, not all digits, or 0.
+ */
+static size_t referencePageNum(const std::string & str){
+    size_t number = 0;
+    for(size_t i = 0; i < str.size(); ++i){
+        if(str[i] < '0' || str[i] > '9'){
+            return 0;
+        }
+        size_t digit = str[i] - '0';
+        number = number > (SIZE_MAX - digit) / 10? SIZE_MAX : number * 10 + digit;
+    }
+    return number;
+}
+
+// the state of the old Page while it reads one file.
+class ReferencePage{
+public:
+    // constructor: problems is NULL to throw the first problem.
+    ReferencePage(std::vector<PageProblem> * problems): problems(problems), result() {
+        result.type = PAGE_NOTYPE;
+        result.label_offsets.push_back(0);
+        result.text_start = Page::NO_TEXT;
+    }
+
+    // the old Page::setPage.
+    void setPage(std::istream & page, bool with_text){
+        int pound_sign = 0;
+        int empty_file = 1;
+        std::string line;
+        size_t line_num = 0;
+        while(getline(page, line)){
+            empty_file = 0;
+            ++line_num;
+            if(pound_sign == 0){
+                try{
+                    if(line == "WIN"){
+                        if(result.type == PAGE_WIN){
+                            pageError("The navigation section of the WIN page has redundant content!");
+                        }
+                        setPageType(PAGE_WIN);
+                    }
+                    else if(line == "LOSE"){
+                        if(result.type == PAGE_LOSE){
+                            pageError("The navigation section of the LOSE page has redundant content!");
+                        }
+                        setPageType(PAGE_LOSE);
+                    }
+                    else{
+                        if(line[0] == '#'){
+                            pound_sign = 1;
+                            if(!with_text){
+                                result.text_start = page.eof()? Page::NO_TEXT : (uint64_t)page.tellg();
+                                return;
+                            }
+                            continue;
+                        }
+                        addChoice(line);
+                    }
+                }
+                catch(StoryError & e){
+                    problem(line_num, e.what());
+                }
+            }
+            else{
+                result.text += line;
+                result.text += '\n';
+            }
+        }
+        if(!page.eof()){
+            problem(0, "Not reach the end of file!");
+        }
+        if(empty_file == 1){
+            problem(0, "It's an empty page, illegal input!");
+        }
+    }
+
+    // get the page as read so far.
+    ParseResult & getResult(){
+        return result;
+    }
+
+private:
+    // the old pageProblem.
+    void problem(size_t line, const std::string & str){
+        if(problems == NULL){
+            pageError(str);
+        }
+        PageProblem p = {line, str};
+        problems->push_back(p);
+    }
+
+    // the old Page::setPageType.
+    void setPageType(PageType type){
+        if(result.type == PAGE_NOTYPE){
+            result.type = type;
+        }
+        else if(result.type != type){
+            pageError("It's a mix type page, illegal!");
+        }
+    }
+
+    // the old Page::isOption and Page::addChoice, setting the type first.
+    void addChoice(const std::string & str){
+        size_t colon = str.find(':');
+        if(colon == str.npos){
+            pageError("This choice has no colon, illegal format!");
+        }
+        size_t pn = referencePageNum(str.substr(0, colon));
+        if(pn == 0){
+            pageError("This choice has illegal page number!");
+        }
+        setPageType(PAGE_CHOICE);
+        result.choices.push_back(pn);
+        result.labels.append(str, colon + 1, std::string::npos);
+        result.label_offsets.push_back(result.labels.size());
+    }
+
+    std::vector<PageProblem> * problems;
+    ParseResult result;
+};
+
+/**
+ * @brief parse page file bytes with the reference parser.
+ * 
+ * @param data the file's bytes.
+ * @param with_text read the story-text too.
+ * @param collect collect the problems instead of throwing the first.
+ * @param result what the parse gives.
+ */
+static void referenceParse(const std::string & data, bool with_text, bool collect, ParseResult & result){
+    std::vector<PageProblem> problems;
+    ReferencePage page(collect? &problems : NULL);
+    std::istringstream stream(data);
+    std::string error;
+    try{
+        page.setPage(stream, with_text);
+    }
+    catch(StoryError & e){
+        error = e.what();
+    }
+    result = page.getResult();
+    result.error = error;
+    result.problems = problems;
+}
+
+/**
+ * @brief the old Page::readText over the file's bytes.
+ * 
+ * @param data the file's bytes.
+ * @param text_start where the story-text starts.
+ * @return std::string the story-text, one '\n' after each line.
+ */
+static std::string referenceText(const std::string & data, uint64_t text_start){
+    std::string text, line;
+    if(text_start == Page::NO_TEXT){
+        return text;
+    }
+    std::istringstream stream(data.substr(text_start));
+    while(getline(stream, line)){
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+// ===================================================
+
+//                  Current parser
+
+// ===================================================
+
+/**
+ * @brief copy a Page into a result.
+ * 
+ * @param page the page read.
+ * @param error the StoryError it threw, or empty.
+ * @param problems the problems collected.
+ * @param result what the parse gives.
+ */
+static void takePage(Page & page, const std::string & error, const std::vector<PageProblem> & problems, ParseResult & result){
+    result.error = error;
+    result.type = page.getType();
+    result.choices = page.getChoices();
+    result.labels = page.getLabels();
+    result.label_offsets = page.getLabelOffsets();
+    result.text = page.getText();
+    result.text_start = page.getTextStart();
+    result.problems = problems;
+}
+
+/**
+ * @brief parse a page file with Page::readPage, from the file.
+ * 
+ * @param file_name the page file.
+ * @param with_text read the story-text too.
+ * @param collect collect the problems instead of throwing the first.
+ * @param result what the parse gives.
+ */
+static void currentParse(const std::string & file_name, bool with_text, bool collect, ParseResult & result){
+    Page page;
+    std::vector<PageProblem> problems;
+    std::string error;
+    try{
+        page.readPage(file_name.c_str(), with_text, collect? &problems : NULL);
+    }
+    catch(StoryError & e){
+        error = e.what();
+    }
+    takePage(page, error, problems, result);
+}
+
+/**
+ * @brief parse a page file with Page::readPage from bytes read already, as
+ * the page loader does: the whole file.
+ * 
+ * @param file_name the page file.
+ * @param data the file's bytes.
+ * @param with_text read the story-text too.
+ * @param collect collect the problems instead of throwing the first.
+ * @param result what the parse gives.
+ */
+static void currentParseHead(const std::string & file_name, const std::string & data, bool with_text, bool collect, ParseResult & result){
+    Page page;
+    std::vector<PageProblem> problems;
+    std::string error;
+    try{
+        page.readPage(file_name.c_str(), data.data(), data.size(), true, with_text, collect? &problems : NULL);
+    }
+    catch(StoryError & e){
+        error = e.what();
+    }
+    takePage(page, error, problems, result);
+}
+
+// ===================================================
+
+//                  Page files
+
+// ===================================================
+
+// random page files: well-formed ones, ones with bad lines, and mutations
+// of both. Lines are sometimes long, so the 16-byte scan and the 4096-byte
+// read blocks are crossed at every offset.
+class PageFuzzer{
+public:
+    // constructor
+    PageFuzzer(uint64_t seed): state(seed) {}
+
+    // the bytes of one page file.
+    std::string nextFile(){
+        std::string data = below(10) == 0? randomBytes(below(64)) : pageFile();
+        size_t mutations = below(3) == 0? 1 + below(4) : 0;
+        for(size_t i = 0; i < mutations; ++i){
+            mutate(data);
+        }
+        return data;
+    }
+
+private:
+    // next pseudo-random number (splitmix64).
+    uint64_t next(){
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // pseudo-random number below n.
+    size_t below(size_t n){
+        return next() % n;
+    }
+
+    // a length, mostly short, sometimes past a scan block or a read block.
+    size_t length(){
+        size_t kind = below(20);
+        return kind == 0? 4000 + below(5000) : kind < 4? 16 + below(64) : below(16);
+    }
+
+    // n bytes, mostly ones the parser looks for.
+    std::string randomBytes(size_t n){
+        static const char alphabet[] = "0123456789:#\n WINLOSEab\r\t\x80\xff";
+        std::string s;
+        for(size_t i = 0; i < n; ++i){
+            s += below(8) == 0? (char)below(256) : alphabet[below(sizeof(alphabet) - 1)];
+        }
+        return s;
+    }
+
+    // a choice label or a line of text.
+    std::string label(){
+        std::string s;
+        size_t n = length();
+        for(size_t i = 0; i < n; ++i){
+            size_t kind = below(40);
+            s += kind == 0? ':' : kind == 1? (char)(0x80 + below(128)) : (char)('a' + below(26));
+        }
+        return s;
+    }
+
+    // the text before a choice's colon, usually a page number.
+    std::string pageNumber(){
+        static const char * const odd[] = {"", "0", "00", "007", "-1", "+3", " 4", "4 ", "1a", "x",
+                                           "2147483647", "2147483648", "4294967295", "4294967296",
+                                           "18446744073709551615", "18446744073709551616",
+                                           "99999999999999999999999999"};
+        if(below(4) == 0){
+            return odd[below(sizeof(odd) / sizeof(odd[0]))];
+        }
+        std::ostringstream s;
+        s << 1 + below(below(2) == 0? 20 : 100000);
+        return s.str();
+    }
+
+    // a line before the '#': WIN, LOSE, a choice, or a bad line.
+    std::string navigationLine(size_t kind){
+        switch(kind){
+        case 0: return "WIN";
+        case 1: return "LOSE";
+        case 2: return below(2) == 0? "WIN " : "lose";
+        case 3: return "";
+        case 4: return label(); // no colon, mostly
+        default: return pageNumber() + ":" + label();
+        }
+    }
+
+    // a page file, mostly well-formed.
+    std::string pageFile(){
+        std::string data;
+        size_t style = below(4); // 0 WIN, 1 LOSE, 2 and 3 choices
+        size_t lines = style < 2? 1 + (below(8) == 0) : 1 + below(6);
+        for(size_t i = 0; i < lines; ++i){
+            size_t kind = style < 2 && below(6) != 0? style : below(8) == 0? below(5) : 5;
+            data += navigationLine(kind);
+            data += '\n';
+        }
+        if(below(10) != 0){
+            data += below(5) == 0? "#" + label() : "#";
+            data += '\n';
+            size_t text_lines = below(6);
+            for(size_t i = 0; i < text_lines; ++i){
+                data += below(6) == 0? "#" + label() : label();
+                data += '\n';
+            }
+            if(below(4) == 0 && !data.empty()){
+                data.erase(data.size() - 1); // no newline at the end
+            }
+        }
+        return data;
+    }
+
+    // insert, erase, change or cut off bytes at a random place.
+    void mutate(std::string & data){
+        size_t at = data.empty()? 0 : below(data.size() + 1);
+        switch(below(4)){
+        case 0:
+            data.insert(at, randomBytes(1 + below(4)));
+            break;
+        case 1:
+            data.erase(at, below(4));
+            break;
+        case 2:
+            if(at < data.size()){
+                data[at] = randomBytes(1)[0];
+            }
+            break;
+        default:
+            data.resize(at);
+        }
+    }
+
+    uint64_t state;
+};
+
+// ===================================================
+
+//                  Comparison
+
+// ===================================================
+
+/**
+ * @brief describe a result, for a mismatch report.
+ * 
+ * @param result the result.
+ * @return std::string one line per field.
+ */
+static std::string describe(const ParseResult & result){
+    std::ostringstream s;
+    s << "  error: " << result.error << "\n  type: " << result.type << "\n  choices:";
+    for(size_t i = 0; i < result.choices.size(); ++i){
+        s << ' ' << result.choices[i];
+    }
+    s << "\n  labels: " << result.labels.size() << " bytes, " << result.label_offsets.size() << " offsets"
+      << "\n  text: " << result.text.size() << " bytes\n  text start: " << result.text_start << "\n  problems:";
+    for(size_t i = 0; i < result.problems.size(); ++i){
+        s << " (" << result.problems[i].line << ") " << result.problems[i].error;
+    }
+    return s.str();
+}
+
+/**
+ * @brief compare two results. When both threw, only the error is compared:
+ * the page is left half-read.
+ * 
+ * @param a a result.
+ * @param b the other.
+ * @return true they are the same.
+ */
+static bool sameResult(const ParseResult & a, const ParseResult & b){
+    if(a.error != b.error){
+        return false;
+    }
+    if(!a.error.empty()){
+        return true;
+    }
+    if(a.problems.size() != b.problems.size()){
+        return false;
+    }
+    for(size_t i = 0; i < a.problems.size(); ++i){
+        if(a.problems[i].line != b.problems[i].line || a.problems[i].error != b.problems[i].error){
+            return false;
+        }
+    }
+    return a.type == b.type && a.choices == b.choices && a.labels == b.labels && a.label_offsets == b.label_offsets
+        && a.text == b.text && a.text_start == b.text_start;
+}
+
+/**
+ * @brief write the bytes as a page file.
+ * 
+ * @param file_name the file.
+ * @param data the bytes.
+ */
+static void writeFile(const std::string & file_name, const std::string & data){
+    std::ofstream file(file_name.c_str(), std::ios::binary);
+    file << data;
+    file.close();
+    if(!file){
+        findError("The page file cannot be written!");
+    }
+}
+
+/**
+ * @brief check one page file in every mode against the reference parser.
+ * 
+ * @param file_name where the file is written.
+ * @param data the file's bytes.
+ * @return true every mode agrees.
+ */
+static bool checkFile(const std::string & file_name, const std::string & data){
+    writeFile(file_name, data);
+    bool same = true;
+    for(int mode = 0; mode < 4; ++mode){
+        bool with_text = mode & 1, collect = mode & 2;
+        ParseResult expected, from_file, from_head;
+        referenceParse(data, with_text, collect, expected);
+        currentParse(file_name, with_text, collect, from_file);
+        currentParseHead(file_name, data, with_text, collect, from_head);
+        const char * way = NULL;
+        const ParseResult * got = NULL;
+        if(!sameResult(expected, from_file)){
+            way = "readPage";
+            got = &from_file;
+        }
+        else if(!sameResult(expected, from_head)){
+            way = "readPage from bytes read";
+            got = &from_head;
+        }
+        else if(!with_text && expected.error.empty()){
+            std::string text, error;
+            try{
+                Page::readText(file_name.c_str(), from_file.text_start, text);
+            }
+            catch(StoryError & e){
+                error = e.what();
+            }
+            if(!error.empty() || text != referenceText(data, expected.text_start)){
+                std::cerr << "readText differs\n";
+                return false;
+            }
+        }
+        if(way != NULL){
+            std::cerr << way << " differs with_text=" << with_text << " collect=" << collect
+                      << "\nreference:\n" << describe(expected) << "\ncurrent:\n" << describe(*got) << '\n';
+            same = false;
+        }
+    }
+    return same;
+}
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t file_num = options.takeNumber("", "--files", 20000);
+    size_t seed = options.takeNumber("", "--seed", 1);
+    options.argumentCheck(2);
+
+    std::string file_name = options[1] + "/page1.txt";
+    PageFuzzer fuzzer(seed);
+    for(size_t i = 0; i < file_num; ++i){
+        std::string data = fuzzer.nextFile();
+        if(!checkFile(file_name, data)){
+            writeFile(options[1] + "/mismatch.txt", data);
+            std::cerr << "page file " << i + 1 << " differs; its bytes are in " << options[1] << "/mismatch.txt\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << file_num << " page files parsed the same in every mode\n";
+    return EXIT_SUCCESS;
+}
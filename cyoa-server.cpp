@@ -0,0 +1,16 @@
+#include "CYOA.hpp"
+#include "Options.hpp"
+#include "StoryServer.hpp"
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    options.argumentCheck(3);
+
+    Story story(options[1], thread_num);
+    StoryServer server(story);
+    server.listen(options[2]);
+    server.run();
+
+    return EXIT_SUCCESS;
+}
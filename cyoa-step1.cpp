@@ -1,10 +1,30 @@
 #include "CYOA.hpp"
+#include "Options.hpp"
+#include "Stats.hpp"
 
 int main(int argc, char** argv){
-    argumentCheck(argc, 2);
-
-    Page current_page(argv[1]);
+    Options options(argc, argv);
+    if(options.takeFlag("--stats")){
+        enableStats();
+    }
+    bool compiled = options.size() == 3 && isStoryFile(options[1]);
+    options.argumentCheck(compiled? 3 : 2);
+    if(compiled){ // a page of a compiled story
+        StoryFile story;
+        story.open(options[1]);
+        size_t pn = Page::isPositiveNum(options[2]);
+        if(pn == 0 || pn > story.getPageNum()){
+            findError("There is a page number out of bound!");
+        }
+        StoryPages pages;
+        story.attachPages(pages);
+        const uint32_t * first_choice = story.getChoiceIndex();
+        OutputBuffer out;
+        pages.printPage(pn, first_choice[pn - 1], first_choice[pn] - first_choice[pn - 1], out);
+        return EXIT_SUCCESS;
+    }
+    Page current_page(options[1].c_str());
     current_page.printPage();
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,10 +1,25 @@
 #include "CYOA.hpp"
+#include "Options.hpp"
+#include "Parallel.hpp"
+#include "Replay.hpp"
+#include "Stats.hpp"
 
 int main(int argc, char** argv){
-    argumentCheck(argc, 2);
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    if(options.takeFlag("--stats")){
+        enableStats();
+    }
+    bool batch = options.takeFlag("--batch");
+    options.argumentCheck(batch? 4 : 2);
 
-    CYOA story(argv[1]);
-    story.readCYOA();
+    Story story(options[1], thread_num);
+    if(batch){ // cyoa-step2 --batch <story> <script directory or manifest> <output directory>
+        replayScripts(story, listScripts(options[2]), options[3], thread_num > 0? thread_num : defaultThreads());
+        return EXIT_SUCCESS;
+    }
+    ReaderSession session(story);
+    session.readCYOA();
 
     return EXIT_SUCCESS;
 }
@@ -1,9 +1,31 @@
 #include "CYOA.hpp"
+#include "Options.hpp"
+#include "Parallel.hpp"
+#include "Stats.hpp"
+#include "StoryWatch.hpp"
 
 int main(int argc, char** argv){
-    argumentCheck(argc, 2);
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    if(options.takeFlag("--stats")){
+        enableStats();
+    }
+    bool watch = options.takeFlag("--watch");
+    std::string cache_dir;
+    bool cached = options.takeValue("", "--cache", cache_dir);
+    options.argumentCheck(2);
 
-    CYOA story(argv[1]);
+    if(watch){ // check the directory again on every change, until interrupted
+        if(isStoryFile(options[1])){
+            findError("--watch needs a story directory!");
+        }
+        StoryWatch watcher(options[1], thread_num > 0? thread_num : defaultThreads());
+        watcher.run();
+    }
+    Story story(options[1], thread_num, true); // no page is printed, so no text is read
+    if(cached){
+        story.useCache(cache_dir);
+    }
     story.printDepth();
 
     return EXIT_SUCCESS;
@@ -1,10 +1,40 @@
 #include "CYOA.hpp"
+#include "Options.hpp"
+#include "Stats.hpp"
 
 int main(int argc, char** argv){
-    argumentCheck(argc, 2);
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", 0); // 0: not given, each phase picks
+    if(options.takeFlag("--stats")){
+        enableStats();
+    }
+    bool count = options.takeFlag("--count");
+    size_t top = options.takeFlag("--shortest")? 1 : 0;
+    top = options.takeNumber("", "--top", top);
+    bool structure = options.takeFlag("--structure");
+    if((count? 1 : 0) + (top > 0? 1 : 0) + (structure? 1 : 0) > 1){
+        findError("Only one of --count, --shortest, --top and --structure can be used!");
+    }
+    std::string cache_dir;
+    bool cached = options.takeValue("", "--cache", cache_dir);
+    options.argumentCheck(2);
 
-    CYOA story(argv[1]);
-    story.printStrategy();
+    Story story(options[1], thread_num, true); // no page is printed, so no text is read
+    if(cached){
+        story.useCache(cache_dir);
+    }
+    if(count){
+        story.printCount();
+    }
+    else if(structure){
+        story.printStructure();
+    }
+    else if(top > 0){
+        story.printShortest(top);
+    }
+    else{
+        story.printStrategy();
+    }
 
     return EXIT_SUCCESS;
 }
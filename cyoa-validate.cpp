@@ -0,0 +1,43 @@
+#include "Options.hpp"
+#include "Parallel.hpp"
+#include "Validate.hpp"
+
+int main(int argc, char** argv){
+    Options options(argc, argv);
+    size_t thread_num = options.takeNumber("-j", "--threads", defaultThreads());
+    options.argumentCheck(options.size()); // only unknown options are errors here
+    if(options.size() < 2){
+        findError("Wrong number of input arguments!");
+    }
+
+    std::vector<std::string> dirs;
+    for(size_t i = 1; i < options.size(); ++i){
+        dirs.push_back(options[i]);
+    }
+    std::vector<StoryReport> reports = validateStories(dirs, thread_num);
+
+    // one JSON object per story, then the totals.
+    OutputBuffer out;
+    std::string line;
+    size_t valid_num = 0, problem_num = 0;
+    for(size_t i = 0; i < reports.size(); ++i){
+        line.clear();
+        appendReport(reports[i], line);
+        line += '\n';
+        out.write(line);
+        valid_num += reports[i].problems.empty();
+        problem_num += reports[i].problems.size();
+    }
+    line = "{\"stories\":";
+    appendNumber(line, reports.size());
+    line += ",\"valid\":";
+    appendNumber(line, valid_num);
+    line += ",\"invalid\":";
+    appendNumber(line, reports.size() - valid_num);
+    line += ",\"errors\":";
+    appendNumber(line, problem_num);
+    line += "}\n";
+    out.write(line);
+
+    return valid_num == reports.size()? EXIT_SUCCESS : EXIT_FAILURE;
+}